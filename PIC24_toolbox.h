@@ -43,6 +43,18 @@
 
 #include "utilities/toolbox_settings.h"
 
+#if __LIBDELAY_DISABLE != 1
+#include "utilities/delay.h"
+#endif
+
+#if __LIBTICKER_DISABLE != 1
+#include "utilities/ticker.h"
+#endif
+
+#if __LIBSCHED_DISABLE != 1
+#include "utilities/sched.h"
+#endif
+
 #if __LIBLCD_DISABLED != 1
 #include "utilities/lcd_generic.h"
 #endif
@@ -55,8 +67,44 @@
 #include "utilities/adcread.h"
 #endif
 
+#if __LIBADCCAL_DISABLE != 1
+#include "utilities/adccal.h"
+#endif
+
+#if __LIBMEASURE_DISABLE != 1
+#include "utilities/measure.h"
+#endif
+
 #if __LIBEEPROM_I2C_DISABLE != 1
 #include "utilities/eeprom.h"
 #endif
 
+#if __LIBI2C_ASYNC_DISABLE != 1
+#include "utilities/i2c_async.h"
+#endif
+
+#if __LIBEEPROM_CACHE_DISABLE != 1
+#include "utilities/eeprom_cache.h"
+#endif
+
+#if __LIBDATALOG_DISABLE != 1
+#include "utilities/datalog.h"
+#endif
+
+#if __LIBCONFIG_DISABLE != 1
+#include "utilities/config.h"
+#endif
+
+#if __LIBRECSTORE_DISABLE != 1
+#include "utilities/recstore.h"
+#endif
+
+#if __LIBESTREAM_DISABLE != 1
+#include "utilities/estream.h"
+#endif
+
+#if __LIBASSET_DISABLE != 1
+#include "utilities/asset.h"
+#endif
+
 #endif
\ No newline at end of file
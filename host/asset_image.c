@@ -0,0 +1,88 @@
+/**
+ * @file  asset_image.c
+ * @brief This file contains the host builder of asset images
+ * @author Jaime Bronozo
+ *
+ * Lays out a list of assets in the format read by asset.c, taking the
+ * magic number and the index size from asset.h and toolbox_settings.h.
+ * The CRC is computed here so the asset_pack tool does not need the
+ * simulator, and the benchmark checks it against EEPROM_crc() by loading
+ * an image built here with asset_begin().
+ *
+ * @date December 14, 2018
+ **************************************************************************/
+
+// only built by a host compiler, never by XC16
+#ifndef __XC16__
+
+#include <string.h>
+
+#define __LIBASSET_SETTINGS
+#include "../utilities/toolbox_settings.h"
+#include "../utilities/i2c_async.h"
+#include "../utilities/asset.h"
+#include "asset_image.h"
+
+// same CRC-16 as EEPROM_crc()
+uint16_t __image_crc(uint8_t *data, int size){
+    uint16_t crc = 0;
+    int i, j;
+
+    for(i = 0; i < size; i++){
+        crc ^= data[i] << 8;
+        for(j = 0; j < 8; j++){
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc ^ 0xffff;
+}
+
+void __image_word(uint8_t *at, uint16_t value){
+    at[0] = value & 0xff;
+    at[1] = value >> 8;
+}
+
+/**
+ * @param image Buffer for the image, written to the chip at
+ * _ASSET_ADDRESS.
+ * @param space Bytes available for the image.
+ * @param count Number of assets, from 1 to _ASSET_INDEX.
+ * @param data Contents of each asset, the first becoming asset 0.
+ * @param size Size of each asset in bytes.
+ *
+ * @brief Builds an asset image.
+ *
+ * @return The size of the image in bytes, or -1 if the count is out of
+ * range or the assets do not fit in *space*.
+ **************************************************************************/
+
+int32_t asset_image_build(uint8_t *image, uint32_t space, int count,
+        uint8_t *const *data, const uint16_t *size){
+    uint32_t end = 4 + count * 4 + 2;
+    uint16_t crc;
+    int i;
+
+    if(count < 1 || count > _ASSET_INDEX || end > space){
+        return -1;
+    }
+
+    __image_word(image, ASSET_MAGIC);
+    __image_word(image + 2, count);
+    for(i = 0; i < count; i++){
+        if(size[i] > space - end){
+            return -1;
+        }
+        memcpy(image + end, data[i], size[i]);
+        __image_word(image + 4 + i * 4, _ASSET_ADDRESS + end);
+        __image_word(image + 6 + i * 4, size[i]);
+        end += size[i];
+    }
+
+    // the CRC is stored high byte first as in the config library
+    crc = __image_crc(image, 4 + count * 4);
+    image[4 + count * 4] = crc >> 8;
+    image[5 + count * 4] = crc & 0xff;
+    return end;
+}
+
+#endif
@@ -0,0 +1,21 @@
+/**
+ * @file  asset_image.h
+ * @brief This file contains the interface of the host asset image builder
+ * @author Jaime Bronozo
+ *
+ * This is a header file for asset_image.c which lays out images for the
+ * asset library. It is shared by the asset_pack tool and the benchmark so
+ * the images the tool writes are the ones checked against asset_begin().
+ *
+ * @date December 14, 2018
+ **************************************************************************/
+
+#ifndef __ASSET_IMAGE_H__
+#define __ASSET_IMAGE_H__
+
+#include <stdint.h>
+
+int32_t asset_image_build(uint8_t *image, uint32_t space, int count,
+        uint8_t *const *data, const uint16_t *size);
+
+#endif
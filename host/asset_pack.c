@@ -0,0 +1,87 @@
+/**
+ * @file  asset_pack.c
+ * @brief This file contains a tool building asset images on the host
+ * @author Jaime Bronozo
+ *
+ * Packs a list of files into an image for asset.c, in the order given so
+ * the first file becomes asset 0. The image is meant to be written to the
+ * chip at _ASSET_ADDRESS, which the addresses in the index assume. The
+ * layout itself is done by asset_image.c.
+ *
+ * Built from the root of the toolbox with a host compiler:
+ *
+ * ```
+ * gcc -Ihost -o asset_pack host/asset_pack.c host/asset_image.c
+ * ./asset_pack image.bin title.txt menu.txt table.bin
+ * ```
+ *
+ * @date December 14, 2018
+ **************************************************************************/
+
+// only built by a host compiler, never by XC16
+#ifndef __XC16__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define __LIBASSET_SETTINGS
+#include "../utilities/toolbox_settings.h"
+#include "asset_image.h"
+
+#define PACK_SIZE 0x8000
+
+uint8_t pack_image[PACK_SIZE];
+uint8_t pack_files[PACK_SIZE + 1];
+
+int main(int argc, char **argv){
+    int count = argc - 2, i;
+    uint8_t *data[_ASSET_INDEX];
+    uint16_t size[_ASSET_INDEX];
+    uint32_t used = 0, space = PACK_SIZE - _ASSET_ADDRESS, left, got;
+    int32_t end;
+    FILE *file;
+
+    if(count < 1 || count > _ASSET_INDEX){
+        fprintf(stderr, "usage: %s image files... (1 to %d files)\n",
+                argv[0], _ASSET_INDEX);
+        return 1;
+    }
+
+    // room left for the files once the header, index and CRC are in
+    left = space - (4 + count * 4 + 2);
+    for(i = 0; i < count; i++){
+        file = fopen(argv[i + 2], "rb");
+        if(!file){
+            perror(argv[i + 2]);
+            return 1;
+        }
+        // asking for a byte more tells a file that fills the chip exactly
+        // from one that does not fit
+        data[i] = pack_files + used;
+        got = fread(data[i], 1, left - used + 1, file);
+        fclose(file);
+        if(got > left - used){
+            fprintf(stderr, "%s: image larger than the chip\n", argv[i + 2]);
+            return 1;
+        }
+        size[i] = got;
+        used += got;
+    }
+
+    end = asset_image_build(pack_image, space, count, data, size);
+    if(end < 0){
+        fprintf(stderr, "assets do not fit in the image\n");
+        return 1;
+    }
+
+    file = fopen(argv[1], "wb");
+    if(!file || fwrite(pack_image, 1, end, file) != (size_t) end){
+        perror(argv[1]);
+        return 1;
+    }
+    fclose(file);
+    printf("%d assets, %lu bytes\n", count, (unsigned long) end);
+    return 0;
+}
+
+#endif
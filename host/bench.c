@@ -0,0 +1,293 @@
+/**
+ * @file  bench.c
+ * @brief This file contains a benchmark of the EEPROM library on the host
+ * @author Jaime Bronozo
+ *
+ * Runs each function of eeprom.c against the simulator in i2c_sim.c and
+ * reports the SCL periods, instruction cycles and time on the device per
+ * call, along with the time taken on the host. The data written is read
+ * back from the simulated chips and checked. The asset library is run on
+ * an image in the second chip, built by the same code as the asset_pack
+ * tool, streaming with and without work done by the CPU between blocks. A second table shows how the library copes with
+ * each fault the simulator can inject.
+ *
+ * Built from the root of the toolbox with a host compiler:
+ *
+ * ```
+ * gcc -Ihost -o bench host/bench.c host/i2c_sim.c host/asset_image.c utilities/eeprom.c utilities/i2c_async.c utilities/asset.c
+ * ./bench
+ * ```
+ *
+ * @date December 13, 2018
+ **************************************************************************/
+
+// only built by a host compiler, never by XC16
+#ifndef __XC16__
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define __LIBASSET_SETTINGS
+#include "../utilities/toolbox_settings.h"
+#include "../utilities/eeprom.h"
+#include "../utilities/i2c_async.h"
+#include "../utilities/asset.h"
+#include "i2c_sim.h"
+#include "asset_image.h"
+
+#define BENCH_RUNS 64
+#define BENCH_WORK 2000
+
+char bench_data[1024];
+char bench_buf[1024];
+uint16_t bench_address = 0;
+uint16_t bench_asset_address = 0;
+int bench_failed = 0;
+
+typedef int (*bench_fn)();
+
+double __bench_host_ns(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+void __bench_check(const char *name, uint16_t address, int size){
+    if(memcmp(sim_memory(0) + address, bench_data + address, size) != 0){
+        printf("%-28s data mismatch at 0x%04x\n", name, address);
+        bench_failed = 1;
+    }
+}
+
+void __bench_run(const char *name, bench_fn fn, int settle){
+    uint64_t cycles = 0, start;
+    uint32_t clocks = 0, before;
+    double host = 0, t;
+    int i, fval = 0;
+
+    for(i = 0; i < BENCH_RUNS; i++){
+        // the write cycle of the previous call is left out of the figures
+        if(settle){
+            EEPROM_wait_write(0);
+        }
+        start = sim_cycles();
+        before = sim_scl_clocks();
+        t = __bench_host_ns();
+        fval = fn();
+        host += __bench_host_ns() - t;
+        cycles += sim_cycles() - start;
+        clocks += sim_scl_clocks() - before;
+        if(fval < 0){
+            printf("%-28s failed with error %d at stage 0x%02x/0x%02x\n",
+                    name, EEPROM_error(), EEPROM_error2(), EEPROM_error3());
+            bench_failed = 1;
+            return;
+        }
+    }
+
+    printf("%-28s %8lu %10llu %10.1f %10.0f\n", name,
+            (unsigned long) clocks / BENCH_RUNS,
+            (unsigned long long) cycles / BENCH_RUNS,
+            cycles * 1e6 / FCY / BENCH_RUNS, host / BENCH_RUNS);
+}
+
+int __bench_present(){
+    return EEPROM_isPresent(0) == 1 ? 0 : -1;
+}
+
+int __bench_write_byte(){
+    bench_address = (bench_address + 1) & 0xff;
+    return EEPROM_write_byte(bench_data[bench_address], bench_address, 0);
+}
+
+int __bench_write_page(){
+    bench_address = (bench_address + 64) & 0x3c0;
+    return EEPROM_write_page(bench_data + bench_address, 64, bench_address, 0);
+}
+
+int __bench_write_cycle(){
+    EEPROM_write_page(bench_data, 64, 0, 0);
+    return EEPROM_wait_write(0);
+}
+
+int __bench_write_1k(){
+    return EEPROM_write(bench_data + 5, 1000, 5, 0);
+}
+
+int __bench_read(){
+    bench_address = (bench_address + 1) & 0x3ff;
+    return EEPROM_read(bench_address, 0);
+}
+
+int __bench_read_64(){
+    return EEPROM_read_block(bench_buf, 64, 0, 0);
+}
+
+int __bench_read_1k(){
+    return EEPROM_read_block(bench_buf, 1024, 0, 0);
+}
+
+int __bench_read_delim(){
+    return EEPROM_read_delim(bench_buf, 64, "\n", 0x200, 0);
+}
+
+int __bench_write_crc(){
+    return EEPROM_write_crc(bench_data, 62, 0x400, 0);
+}
+
+int __bench_read_crc(){
+    return EEPROM_read_crc(bench_buf, 62, 0x400, 0);
+}
+
+int __bench_asset_begin(){
+    return asset_begin() == 2 ? 0 : -1;
+}
+
+int __bench_asset_text(){
+    return asset_text(0, bench_buf, 64);
+}
+
+int __bench_asset_stream(int work){
+    asset_stream_t stream;
+    char *block;
+    int size, count = 0;
+
+    asset_open(&stream, 1);
+    while((size = asset_next(&stream, &block)) > 0){
+        memcpy(bench_buf + count, block, size);
+        count += size;
+        sim_step(work);
+    }
+    asset_close(&stream);
+    return size < 0 ? -1 : count;
+}
+
+int __bench_asset_1k(){
+    return __bench_asset_stream(0);
+}
+
+int __bench_asset_1k_work(){
+    return __bench_asset_stream(BENCH_WORK);
+}
+
+int __bench_read_1k_work(){
+    int i;
+
+    for(i = 0; i < 1024; i += _ASSET_BLOCK){
+        if(EEPROM_read_block(bench_buf + i, _ASSET_BLOCK, bench_asset_address + i, _ASSET_DEV) < 0){
+            return -1;
+        }
+        sim_step(BENCH_WORK);
+    }
+    return 0;
+}
+
+// built with the code of the asset_pack tool so its images are checked
+void __bench_asset_image(){
+    uint8_t *data[2] = {(uint8_t *) "a string of 31 characters read\n",
+            (uint8_t *) bench_data};
+    uint16_t size[2] = {31, 1024};
+    uint8_t *image = sim_memory(_ASSET_DEV) + _ASSET_ADDRESS;
+
+    if(asset_image_build(image, 0x8000 - _ASSET_ADDRESS, 2, data, size) < 0){
+        printf("asset image does not fit\n");
+        bench_failed = 1;
+    }
+    bench_asset_address = image[8] | (image[9] << 8);
+}
+
+void __bench_fault(const char *name, int fault, uint32_t count, bench_fn fn){
+    const eeprom_stats_t *stats = EEPROM_stats();
+    int fval;
+
+    EEPROM_wait_write(0);
+    EEPROM_stats_clear();
+    sim_fault(fault, count);
+    fval = fn();
+    printf("%-28s %6d %6d %6lu %6lu %6lu %6lu\n", name, fval,
+            fval < 0 ? EEPROM_error() : 0,
+            (unsigned long) stats->timeouts, (unsigned long) stats->recoveries,
+            (unsigned long) stats->retries, (unsigned long) stats->collisions);
+
+    // lets stuck lines go before the next fault
+    sim_step(FCY / 10);
+}
+
+void __bench_power_cut(){
+    uint8_t *memory = sim_memory(0);
+    int i, lost = 0;
+
+    EEPROM_wait_write(0);
+    memset(bench_buf, 0x55, 64);
+    EEPROM_write_page(bench_buf, 64, 0x1000, 0);
+    sim_power_cut();
+    EEPROM_begin();
+    for(i = 0; i < 64; i++){
+        lost += memory[0x1000 + i] != 0x55;
+    }
+    printf("%-28s %d of 64 bytes undefined, chip %s\n", "power cut in write cycle",
+            lost, EEPROM_isPresent(0) == 1 ? "present" : "missing");
+}
+
+int main(){
+    uint32_t i;
+
+    for(i = 0; i < sizeof(bench_data); i++){
+        bench_data[i] = (i * 7 + 3) & 0xff;
+    }
+    sim_reset(2);
+    EEPROM_begin();
+
+    printf("I2C at %lu Hz, FCY at %lu Hz, averages of %d calls\n\n",
+            (unsigned long) eeprom_scl_hz, (unsigned long) FCY, BENCH_RUNS);
+    printf("%-28s %8s %10s %10s %10s\n", "call", "SCL", "cycles", "us", "host ns");
+
+    __bench_run("EEPROM_isPresent", __bench_present, 1);
+    __bench_run("EEPROM_write_byte", __bench_write_byte, 1);
+    __bench_check("EEPROM_write_byte", 1, BENCH_RUNS);
+    __bench_run("EEPROM_write_page 64", __bench_write_page, 1);
+    EEPROM_wait_write(0);
+    __bench_check("EEPROM_write_page 64", 0, 1024);
+    __bench_run("write_page + wait_write", __bench_write_cycle, 1);
+    __bench_run("EEPROM_write 1000", __bench_write_1k, 1);
+    EEPROM_wait_write(0);
+    __bench_check("EEPROM_write 1000", 5, 1000);
+    __bench_run("EEPROM_read", __bench_read, 0);
+    __bench_run("EEPROM_read_block 64", __bench_read_64, 0);
+    __bench_run("EEPROM_read_block 1024", __bench_read_1k, 0);
+    if(memcmp(bench_buf, bench_data, 1024) != 0){
+        printf("EEPROM_read_block gave wrong data\n");
+        bench_failed = 1;
+    }
+
+    memcpy(sim_memory(0) + 0x200, "a string of 31 characters read\n", 31);
+    __bench_run("EEPROM_read_delim 31", __bench_read_delim, 0);
+    __bench_run("EEPROM_write_crc 62", __bench_write_crc, 1);
+    __bench_run("EEPROM_read_crc 62", __bench_read_crc, 1);
+
+    __bench_asset_image();
+    __bench_run("asset_begin", __bench_asset_begin, 0);
+    __bench_run("asset_text 31", __bench_asset_text, 0);
+    __bench_run("asset stream 1024", __bench_asset_1k, 0);
+    if(memcmp(bench_buf, bench_data, 1024) != 0){
+        printf("asset stream gave wrong data\n");
+        bench_failed = 1;
+    }
+    __bench_run("read_block 32 + work", __bench_read_1k_work, 0);
+    __bench_run("asset stream 1024 + work", __bench_asset_1k_work, 0);
+
+    printf("\n%-28s %6s %6s %6s %6s %6s %6s\n", "fault", "return", "error",
+            "tmout", "recov", "retry", "coll");
+    __bench_fault("collision on control byte", SIM_FAULT_COLLISION, 0, __bench_read_64);
+    __bench_fault("collision on data byte", SIM_FAULT_COLLISION, 4, __bench_write_page);
+    __bench_fault("NACK on address byte", SIM_FAULT_NACK, 1, __bench_read_64);
+    __bench_fault("SDA stuck for 5 clocks", SIM_FAULT_STUCK_SDA, 5, __bench_read_64);
+    __bench_fault("SCL stuck for 1ms", SIM_FAULT_STUCK_SCL, FCY / 1000, __bench_read_64);
+    __bench_fault("SCL stuck for 50ms", SIM_FAULT_STUCK_SCL, FCY / 20, __bench_read_64);
+    __bench_power_cut();
+
+    return bench_failed;
+}
+
+#endif
@@ -0,0 +1,921 @@
+/**
+ * @file  i2c_sim.c
+ * @brief This file contains a simulator of the I2C bus and 24LC256 chips
+ * @author Jaime Bronozo
+ *
+ * This is a simulator for testing and benchmarking the EEPROM libraries
+ * on a desktop computer without a board. It keeps a clock counted in
+ * instruction cycles that moves forward with every register access and
+ * every __delay32(). The bus is simulated at the level of the SDA and SCL
+ * lines. The master is either a model of the I2C module of the PIC24
+ * driven through its registers, or the software master of eeprom.c
+ * driving the pins, and up to eight 24LC256 chips react to the edges on
+ * the lines. The master interrupt is raised like on the device and calls
+ * the handler of i2c_async.c when it is linked in. Timer1 counts with the
+ * same clock and calls the handler of ticker.c on every period match.
+ *
+ * The chips follow the datasheet. Bytes written wrap within a 64 byte
+ * page, the page is programmed at the stop condition, a chip does not
+ * acknowledge its control byte during the 5ms of its write cycle, and
+ * sequential reads wrap from the last address back to the first. Bus
+ * collisions, NACKs, stuck lines and the chips losing power in the middle
+ * of a write can be injected with sim_fault(), and sim_power_cut() leaves
+ * the bytes of a page being programmed undefined. Every byte programmed is
+ * counted, so the wear of each cell can be read with sim_cell_writes().
+ *
+ * @date December 13, 2018
+ **************************************************************************/
+
+/// @cond
+// only built by a host compiler, never by XC16
+#ifndef __XC16__
+#define __LIBEEPROM_I2C_SETTINGS
+
+#include <string.h>
+#include "../utilities/toolbox_settings.h"
+#include "i2c_sim.h"
+
+#define __SIM_WRITE_CYCLES (FCY / 200)
+
+// what the chips make of the byte on the bus
+#define __S_IDLE 0
+#define __S_CONTROL 1
+#define __S_ADDR_HI 2
+#define __S_ADDR_LO 3
+#define __S_WRITE 4
+#define __S_READ 5
+
+// events of the I2C module
+#define __M_IDLE 0
+#define __M_START 1
+#define __M_RESTART 2
+#define __M_STOP 3
+#define __M_SEND 4
+#define __M_RECEIVE 5
+#define __M_ACK 6
+
+void _MI2C1Interrupt(void) __attribute__((weak));
+void _T1Interrupt(void) __attribute__((weak));
+/// @endcond
+
+typedef struct {
+    uint8_t memory[SIM_CHIP_SIZE];
+    uint8_t latch[SIM_PAGE_SIZE];
+    uint64_t loaded;        // bytes of the latch written since addressing
+    uint64_t programmed;    // bytes of the page in its write cycle
+    uint64_t busy_until;
+    uint16_t pointer;
+    uint16_t page;
+    uint32_t writes[SIM_CHIP_SIZE / SIM_PAGE_SIZE];
+    uint32_t cells[SIM_CHIP_SIZE];  // write cycles of each byte
+} sim_chip_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t bit;            // rising edges of SCL seen in the byte
+    uint8_t shift;
+    uint8_t sda;            // 0 while a chip pulls SDA low
+    uint8_t tx;             // 1 while a chip sends the byte
+    uint8_t nacked;
+    uint8_t high;
+    sim_chip_t *chip;
+} sim_slave_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t step;
+    uint8_t bit;
+    uint8_t shift;
+    uint8_t sda;            // 0 while the module pulls SDA low
+    uint8_t scl;
+    uint64_t next;
+} sim_master_t;
+
+typedef struct {
+    uint32_t collision;     // bytes left before the fault plus one
+    uint32_t nack;
+    uint64_t sda_until;     // another master holds SDA low until then
+    uint32_t stuck;         // clocks a chip still holds SDA low for
+    uint64_t scl_until;
+    uint32_t power;         // bytes left before the chips lose power plus one
+    uint8_t off;            // 1 while the chips have no power
+} sim_faults_t;
+
+sim_chip_t sim_chip[8];
+int sim_chip_count = 0;
+sim_i2c_t sim_regs;
+sim_port_t sim_ports[2];
+sim_slave_t sim_slave;
+sim_master_t sim_master;
+sim_faults_t sim_faults;
+sim_timer_t sim_timer1;
+uint64_t sim_timer_at;      // time of the last count of Timer1
+unsigned int sim_timer_shown;
+
+uint64_t sim_now = 0;
+uint32_t sim_clocks = 0;
+uint32_t sim_seed = 1;
+uint8_t sim_sda = 1, sim_scl = 1;
+uint8_t sim_busy = 0, sim_in_isr = 0;
+
+volatile unsigned int *sim_sda_lat, *sim_sda_tris, *sim_sda_port;
+volatile unsigned int *sim_scl_lat, *sim_scl_tris, *sim_scl_port;
+
+uint8_t __sim_random(){
+    sim_seed = sim_seed * 1103515245 + 12345;
+    return sim_seed >> 16;
+}
+
+uint8_t __sim_master_sda(){
+    if(sim_regs.con.I2CEN){
+        return sim_master.sda;
+    }
+    // with the module off the pins are open drain through TRIS
+    return *sim_sda_tris || *sim_sda_lat;
+}
+
+uint8_t __sim_master_scl(){
+    if(sim_regs.con.I2CEN){
+        return sim_master.scl;
+    }
+    return *sim_scl_tris || *sim_scl_lat;
+}
+
+uint8_t __sim_line_sda(){
+    return __sim_master_sda() && sim_slave.sda && !sim_faults.stuck
+            && sim_now >= sim_faults.sda_until;
+}
+
+void __sim_chips_off(){
+    sim_chip_t *chip;
+    int i, j;
+
+    for(i = 0; i < sim_chip_count; i++){
+        chip = &sim_chip[i];
+        if(sim_now < chip->busy_until){
+            for(j = 0; j < SIM_PAGE_SIZE; j++){
+                if(chip->programmed & (1ULL << j)){
+                    chip->memory[chip->page * SIM_PAGE_SIZE + j] = __sim_random();
+                }
+            }
+        }
+        chip->busy_until = 0;
+        chip->loaded = 0;
+    }
+    sim_slave.state = __S_IDLE;
+    sim_slave.sda = 1;
+}
+
+void __sim_byte_begins(){
+    // as long as another master takes to send a byte
+    if(sim_faults.collision && --sim_faults.collision == 0){
+        sim_faults.sda_until = sim_now + 9ULL * FCY / _I2C_SCL_HZ;
+    }
+    if(sim_faults.power && --sim_faults.power == 0){
+        sim_faults.off = 1;
+        __sim_chips_off();
+    }
+}
+
+void __sim_program(sim_chip_t *chip){
+    uint16_t base = chip->pointer & ~(SIM_PAGE_SIZE - 1);
+    int i;
+
+    for(i = 0; i < SIM_PAGE_SIZE; i++){
+        if(chip->loaded & (1ULL << i)){
+            chip->memory[base + i] = chip->latch[i];
+            chip->cells[base + i]++;
+        }
+    }
+    chip->page = base / SIM_PAGE_SIZE;
+    chip->writes[chip->page]++;
+    chip->programmed = chip->loaded;
+    chip->loaded = 0;
+    chip->busy_until = sim_now + __SIM_WRITE_CYCLES;
+}
+
+void __sim_start(){
+    // a write is dropped unless it ends with a stop
+    if(sim_slave.chip){
+        sim_slave.chip->loaded = 0;
+    }
+    // a chip without power ignores the bus
+    if(sim_faults.off){
+        return;
+    }
+    sim_slave.state = __S_CONTROL;
+    sim_slave.bit = 0;
+    sim_slave.shift = 0;
+    sim_slave.sda = 1;
+    sim_slave.tx = 0;
+    __sim_byte_begins();
+}
+
+void __sim_stop(){
+    // the page is programmed only if the stop follows a whole byte
+    if(sim_slave.state == __S_WRITE && sim_slave.bit <= 1
+            && sim_slave.chip->loaded){
+        __sim_program(sim_slave.chip);
+    }
+    sim_slave.state = __S_IDLE;
+    sim_slave.sda = 1;
+}
+
+int __sim_receive(uint8_t byte){
+    sim_chip_t *chip = sim_slave.chip;
+    int dev, i;
+
+    if(sim_faults.nack && --sim_faults.nack == 0){
+        sim_slave.state = __S_IDLE;
+        return 0;
+    }
+
+    switch(sim_slave.state){
+        case __S_CONTROL:
+            dev = (byte >> 1) & 7;
+            if((byte & 0xf0) != 0xa0 || dev >= sim_chip_count
+                    || sim_now < sim_chip[dev].busy_until){
+                sim_slave.state = __S_IDLE;
+                return 0;
+            }
+            sim_slave.chip = &sim_chip[dev];
+            sim_slave.state = (byte & 1) ? __S_READ : __S_ADDR_HI;
+            return 1;
+        case __S_ADDR_HI:
+            sim_slave.high = byte & 0x7f;
+            sim_slave.state = __S_ADDR_LO;
+            return 1;
+        case __S_ADDR_LO:
+            chip->pointer = (sim_slave.high << 8) | byte;
+            chip->loaded = 0;
+            sim_slave.state = __S_WRITE;
+            return 1;
+        case __S_WRITE:
+            i = chip->pointer & (SIM_PAGE_SIZE - 1);
+            chip->latch[i] = byte;
+            chip->loaded |= 1ULL << i;
+            chip->pointer = (chip->pointer & ~(SIM_PAGE_SIZE - 1))
+                    | ((i + 1) & (SIM_PAGE_SIZE - 1));
+            return 1;
+    }
+    return 0;
+}
+
+void __sim_rise(){
+    sim_clocks++;
+    if(sim_slave.state == __S_IDLE){
+        return;
+    }
+
+    if(sim_slave.bit < 8){
+        if(!sim_slave.tx){
+            sim_slave.shift = (sim_slave.shift << 1) | sim_sda;
+        }
+        sim_slave.bit++;
+    }
+    else if(sim_slave.bit == 8){
+        if(sim_slave.tx){
+            sim_slave.nacked = sim_sda;
+        }
+        sim_slave.bit = 9;
+    }
+}
+
+void __sim_fall(){
+    sim_chip_t *chip = sim_slave.chip;
+
+    if(sim_faults.stuck){
+        sim_faults.stuck--;
+    }
+    if(sim_slave.state == __S_IDLE){
+        return;
+    }
+
+    if(sim_slave.bit == 8){
+        // acknowledges a received byte or lets the master do it
+        sim_slave.sda = sim_slave.tx || !__sim_receive(sim_slave.shift);
+    }
+    else if(sim_slave.bit == 9){
+        sim_slave.sda = 1;
+        sim_slave.bit = 0;
+        if(sim_slave.state == __S_READ){
+            if(sim_slave.tx && sim_slave.nacked){
+                sim_slave.state = __S_IDLE;
+                return;
+            }
+            sim_slave.shift = chip->memory[chip->pointer];
+            chip->pointer = (chip->pointer + 1) & (SIM_CHIP_SIZE - 1);
+            sim_slave.tx = 1;
+            sim_slave.sda = sim_slave.shift >> 7;
+        }
+        __sim_byte_begins();
+    }
+    else if(sim_slave.tx && sim_slave.bit > 0){
+        sim_slave.sda = (sim_slave.shift >> (7 - sim_slave.bit)) & 1;
+    }
+}
+
+uint32_t __sim_timer_scale(){
+    static const uint16_t scale[4] = {1, 8, 64, 256};
+    return scale[sim_timer1.con.TCKPS];
+}
+
+// counts from the current value to the next period match
+uint32_t __sim_timer_left(){
+    uint16_t count = sim_timer1.tmr, pr = sim_timer1.pr;
+    return (count <= pr) ? pr - count + 1UL : 0x10000UL - count + pr + 1;
+}
+
+void __sim_timer_sync(){
+    uint32_t scale = __sim_timer_scale(), counts, left;
+
+    // a value written by the program restarts the count from it
+    if(sim_timer1.tmr != sim_timer_shown || !sim_timer1.con.TON){
+        sim_timer_at = sim_now;
+    }
+    counts = (sim_now - sim_timer_at) / scale;
+    sim_timer_at += (uint64_t) counts * scale;
+    while(counts){
+        left = __sim_timer_left();
+        if(counts < left){
+            sim_timer1.tmr = (sim_timer1.tmr + counts) & 0xffff;
+            break;
+        }
+        counts -= left;
+        sim_timer1.tmr = 0;
+        sim_timer1.flag = 1;
+    }
+    sim_timer_shown = sim_timer1.tmr;
+}
+
+uint64_t __sim_timer_next(){
+    if(!sim_timer1.con.TON || !sim_timer1.enable){
+        return ~0ULL;
+    }
+    return sim_timer_at + (uint64_t) __sim_timer_left() * __sim_timer_scale();
+}
+
+void __sim_wire(){
+    uint8_t sda = __sim_line_sda();
+    uint8_t scl = __sim_master_scl() && sim_now >= sim_faults.scl_until;
+
+    // SDA changing while SCL stays high is a start or a stop
+    if(sda != sim_sda){
+        sim_sda = sda;
+        if(sim_scl && scl){
+            if(sda){
+                __sim_stop();
+            }
+            else{
+                __sim_start();
+            }
+        }
+    }
+    if(scl != sim_scl){
+        sim_scl = scl;
+        if(scl){
+            __sim_rise();
+        }
+        else{
+            __sim_fall();
+        }
+        sim_sda = __sim_line_sda();
+    }
+
+    *sim_sda_port = sim_sda;
+    *sim_scl_port = sim_scl;
+}
+
+uint32_t __sim_half(){
+    uint32_t period = (sim_regs.brg & 0x1ff) + 1 + FCY / 10000000;
+    return (period / 2) ? period / 2 : 1;
+}
+
+void __sim_master_done(){
+    sim_master.op = __M_IDLE;
+    sim_master.step = 0;
+    sim_regs.flag = 1;
+}
+
+void __sim_master_collision(){
+    volatile I2C1CONBITS *con = &sim_regs.con;
+
+    con->SEN = con->RSEN = con->PEN = con->RCEN = con->ACKEN = 0;
+    sim_regs.stat.TRSTAT = 0;
+    sim_regs.stat.TBF = 0;
+    sim_regs.stat.BCL = 1;
+    sim_master.sda = 1;
+    sim_master.scl = 1;
+    __sim_master_done();
+}
+
+void __sim_master_begin(){
+    volatile I2C1CONBITS *con = &sim_regs.con;
+    uint8_t op = __M_IDLE;
+
+    if(!con->I2CEN){
+        sim_master.op = __M_IDLE;
+        sim_master.sda = 1;
+        sim_master.scl = 1;
+        sim_regs.trn = SIM_TRN_EMPTY;
+        return;
+    }
+
+    if(con->SEN){
+        op = __M_START;
+    }
+    else if(con->RSEN){
+        op = __M_RESTART;
+    }
+    else if(con->PEN){
+        op = __M_STOP;
+    }
+    else if(con->RCEN){
+        op = __M_RECEIVE;
+    }
+    else if(con->ACKEN){
+        op = __M_ACK;
+    }
+
+    // the module does one event at a time and ignores the rest
+    if(sim_regs.trn != SIM_TRN_EMPTY){
+        if(sim_master.op != __M_IDLE || op != __M_IDLE){
+            sim_regs.stat.IWCOL = 1;
+            sim_regs.trn = SIM_TRN_EMPTY;
+        }
+        else{
+            op = __M_SEND;
+            sim_master.shift = sim_regs.trn;
+            sim_regs.trn = SIM_TRN_EMPTY;
+            sim_regs.stat.TBF = 1;
+            sim_regs.stat.TRSTAT = 1;
+        }
+    }
+    if(sim_master.op != __M_IDLE || op == __M_IDLE){
+        return;
+    }
+
+    sim_master.op = op;
+    sim_master.step = 0;
+    sim_master.bit = 0;
+    sim_master.next = sim_now;
+    if(op == __M_RECEIVE){
+        sim_master.shift = 0;
+    }
+}
+
+void __sim_master_run(){
+    sim_master_t *m = &sim_master;
+    volatile I2C1CONBITS *con = &sim_regs.con;
+    volatile I2C1STATBITS *stat = &sim_regs.stat;
+    // each half of an SCL period, the data changing a cycle after a fall
+    uint32_t half = __sim_half();
+
+    // a slave holding SCL low stretches the clock
+    if(m->scl && !sim_scl){
+        m->next = sim_now + 1;
+        return;
+    }
+    m->next = sim_now + half;
+
+    switch(m->op){
+        case __M_START:
+            if(m->step == 0){
+                if(!sim_sda || !sim_scl){
+                    __sim_master_collision();
+                    return;
+                }
+                m->sda = 0;
+            }
+            else{
+                m->scl = 0;
+                con->SEN = 0;
+                stat->S = 1;
+                stat->P = 0;
+                __sim_master_done();
+                return;
+            }
+            break;
+        case __M_RESTART:
+            if(m->step == 0){
+                m->sda = 1;
+            }
+            else if(m->step == 1){
+                m->scl = 1;
+            }
+            else if(m->step == 2){
+                if(!sim_sda){
+                    __sim_master_collision();
+                    return;
+                }
+                m->sda = 0;
+            }
+            else{
+                m->scl = 0;
+                con->RSEN = 0;
+                __sim_master_done();
+                return;
+            }
+            break;
+        case __M_STOP:
+            if(m->step == 0){
+                m->sda = 0;
+            }
+            else if(m->step == 1){
+                m->scl = 1;
+            }
+            else if(m->step == 2){
+                m->sda = 1;
+            }
+            else{
+                if(!sim_sda){
+                    __sim_master_collision();
+                    return;
+                }
+                con->PEN = 0;
+                stat->P = 1;
+                stat->S = 0;
+                __sim_master_done();
+                return;
+            }
+            break;
+        case __M_SEND:
+            if(m->step == 0){
+                m->sda = (m->bit < 8) ? (m->shift >> (7 - m->bit)) & 1 : 1;
+                m->next = sim_now + half - 1;
+            }
+            else if(m->step == 1){
+                m->scl = 1;
+            }
+            else{
+                if(m->bit < 8 && m->sda && !sim_sda){
+                    __sim_master_collision();
+                    return;
+                }
+                if(m->bit == 8){
+                    stat->ACKSTAT = sim_sda;
+                }
+                m->scl = 0;
+                m->step = 0;
+                m->next = sim_now + 1;
+                if(++m->bit == 8){
+                    stat->TBF = 0;
+                }
+                else if(m->bit == 9){
+                    stat->TRSTAT = 0;
+                    __sim_master_done();
+                }
+                return;
+            }
+            break;
+        case __M_RECEIVE:
+            if(m->step == 0){
+                m->sda = 1;
+                m->next = sim_now + half - 1;
+            }
+            else if(m->step == 1){
+                m->scl = 1;
+            }
+            else{
+                m->shift = (m->shift << 1) | sim_sda;
+                m->scl = 0;
+                m->step = 0;
+                m->next = sim_now + 1;
+                if(++m->bit == 8){
+                    con->RCEN = 0;
+                    if(stat->RBF){
+                        stat->I2COV = 1;
+                    }
+                    else{
+                        sim_regs.rcv = m->shift;
+                        stat->RBF = 1;
+                    }
+                    __sim_master_done();
+                }
+                return;
+            }
+            break;
+        case __M_ACK:
+            if(m->step == 0){
+                m->sda = con->ACKDT;
+            }
+            else if(m->step == 1){
+                m->scl = 1;
+            }
+            else if(m->step == 2){
+                m->scl = 0;
+            }
+            else{
+                m->sda = 1;
+                con->ACKEN = 0;
+                __sim_master_done();
+                return;
+            }
+            break;
+    }
+    m->step++;
+}
+
+/**
+ * @param cycles Number of instruction cycles.
+ *
+ * @brief Moves the simulated time forward.
+ *
+ * Applies what was written to the registers and pins since the last step,
+ * then runs the I2C module and the chips for the given number of cycles.
+ * The master I2C interrupt handler is called as soon as the flag and the
+ * enable bit are both set, so transfers driven by interrupts go on while
+ * the application spends the cycles elsewhere.
+ *
+ * @return none
+ **************************************************************************/
+
+void __sim_interrupt(){
+    if(sim_timer1.flag && sim_timer1.enable && !sim_in_isr && _T1Interrupt){
+        sim_in_isr = 1;
+        sim_busy = 0;
+        _T1Interrupt();
+        sim_busy = 1;
+        sim_in_isr = 0;
+        __sim_timer_sync();
+    }
+    if(sim_regs.flag && sim_regs.enable && !sim_in_isr && _MI2C1Interrupt){
+        sim_in_isr = 1;
+        sim_busy = 0;
+        _MI2C1Interrupt();
+        sim_busy = 1;
+        sim_in_isr = 0;
+        // registers written last by the handler
+        __sim_master_begin();
+        __sim_wire();
+    }
+}
+
+void sim_step(uint32_t cycles){
+    uint64_t target = sim_now + cycles, next;
+
+    if(sim_busy){
+        return;
+    }
+    sim_busy = 1;
+
+    __sim_master_begin();
+    __sim_wire();
+    __sim_timer_sync();
+    while(1){
+        next = target;
+        if(__sim_timer_next() < next){
+            next = __sim_timer_next();
+        }
+        if(sim_master.op != __M_IDLE && sim_master.next < next){
+            next = sim_master.next;
+        }
+        if(sim_faults.scl_until > sim_now && sim_faults.scl_until < next){
+            next = sim_faults.scl_until;
+        }
+        if(sim_faults.sda_until > sim_now && sim_faults.sda_until < next){
+            next = sim_faults.sda_until;
+        }
+        if(next >= target){
+            break;
+        }
+        sim_now = next;
+        if(sim_master.op != __M_IDLE && sim_master.next <= sim_now){
+            __sim_master_run();
+        }
+        __sim_wire();
+        __sim_timer_sync();
+        // the handler takes cycles of its own and may pass the target
+        __sim_interrupt();
+    }
+    if(sim_now < target){
+        sim_now = target;
+    }
+    if(sim_master.op != __M_IDLE && sim_master.next <= sim_now){
+        __sim_master_run();
+    }
+    __sim_wire();
+    __sim_timer_sync();
+    __sim_interrupt();
+    sim_busy = 0;
+}
+
+/// @cond
+sim_i2c_t *sim_i2c(){
+    sim_step(SIM_ACCESS_CYCLES);
+    return &sim_regs;
+}
+
+volatile unsigned int *sim_rcv(){
+    sim_step(SIM_ACCESS_CYCLES);
+    sim_regs.stat.RBF = 0;
+    return &sim_regs.rcv;
+}
+
+sim_port_t *sim_port(int port){
+    sim_step(SIM_ACCESS_CYCLES);
+    return &sim_ports[port & 1];
+}
+
+sim_timer_t *sim_timer(){
+    sim_step(SIM_ACCESS_CYCLES);
+    return &sim_timer1;
+}
+
+void __delay32(unsigned long cycles){
+    sim_step(cycles);
+}
+/// @endcond
+
+/**
+ * @param chips Number of 24LC256 chips on the bus, at device addresses 0
+ * up to *chips* - 1.
+ *
+ * @brief Resets the simulator.
+ *
+ * Erases the chips to 0xff, clears the registers, the faults and the
+ * counters and sets the time back to 0.
+ *
+ * @return none
+ **************************************************************************/
+
+void sim_reset(int chips){
+    int i;
+
+    memset(sim_chip, 0, sizeof(sim_chip));
+    for(i = 0; i < 8; i++){
+        memset(sim_chip[i].memory, 0xff, SIM_CHIP_SIZE);
+    }
+    sim_chip_count = (chips > 8) ? 8 : chips;
+
+    memset(&sim_regs, 0, sizeof(sim_regs));
+    sim_regs.trn = SIM_TRN_EMPTY;
+    memset(sim_ports, 0, sizeof(sim_ports));
+    for(i = 0; i < 16; i++){
+        sim_ports[0].tris[i] = 1;
+        sim_ports[1].tris[i] = 1;
+    }
+    memset(&sim_slave, 0, sizeof(sim_slave));
+    sim_slave.sda = 1;
+    memset(&sim_master, 0, sizeof(sim_master));
+    sim_master.sda = 1;
+    sim_master.scl = 1;
+    memset(&sim_faults, 0, sizeof(sim_faults));
+    memset(&sim_timer1, 0, sizeof(sim_timer1));
+    sim_timer1.pr = 0xffff;
+    sim_timer_at = 0;
+    sim_timer_shown = 0;
+
+    sim_now = 0;
+    sim_clocks = 0;
+    sim_seed = 1;
+    sim_sda = 1;
+    sim_scl = 1;
+    sim_in_isr = 0;
+
+    // the pins come from the settings of the EEPROM library
+    sim_busy = 1;
+    sim_sda_lat = &__LATx(_I2C_SDA);
+    sim_sda_tris = &__TRISx(_I2C_SDA);
+    sim_sda_port = &__PORTx(_I2C_SDA);
+    sim_scl_lat = &__LATx(_I2C_SCL);
+    sim_scl_tris = &__TRISx(_I2C_SCL);
+    sim_scl_port = &__PORTx(_I2C_SCL);
+    *sim_sda_port = 1;
+    *sim_scl_port = 1;
+    sim_busy = 0;
+}
+
+/**
+ * @param fault One of the SIM_FAULT_* values.
+ * @param count For #SIM_FAULT_COLLISION and #SIM_FAULT_NACK, the number of
+ * bytes let through before the fault. For #SIM_FAULT_STUCK_SDA, the
+ * number of SCL clocks SDA stays low. For #SIM_FAULT_STUCK_SCL, the number
+ * of instruction cycles SCL stays low. For #SIM_FAULT_POWER_CUT, the number
+ * of bytes let through before the chips lose power.
+ *
+ * @brief Injects a fault on the bus.
+ *
+ * Bytes are counted from the next one starting on the bus. A collision
+ * holds SDA low for as long as another master takes to send a byte at
+ * _I2C_SCL_HZ, and a NACK is given for a byte received by the chips.
+ * Stuck lines take effect at once, like a chip reset in the middle of a
+ * read or a short on SCL.
+ *
+ * @return none
+ **************************************************************************/
+
+void sim_fault(int fault, uint32_t count){
+    switch(fault){
+        case SIM_FAULT_COLLISION:
+            sim_faults.collision = count + 1;
+            break;
+        case SIM_FAULT_NACK:
+            sim_faults.nack = count + 1;
+            break;
+        case SIM_FAULT_STUCK_SDA:
+            sim_slave.state = __S_IDLE;
+            sim_faults.stuck = count;
+            break;
+        case SIM_FAULT_STUCK_SCL:
+            sim_faults.scl_until = sim_now + count;
+            break;
+        case SIM_FAULT_POWER_CUT:
+            sim_faults.power = count + 1;
+            break;
+    }
+    sim_busy = 1;
+    __sim_wire();
+    sim_busy = 0;
+}
+
+/**
+ * @brief Cuts the power of the chips and of the I2C module.
+ *
+ * A chip in its write cycle leaves the bytes it was programming with
+ * random values while the rest of the page keeps its contents. The
+ * registers are cleared so EEPROM_begin() must be called again, as after
+ * a reset of the device. Chips that lost power with #SIM_FAULT_POWER_CUT
+ * have it back afterwards.
+ *
+ * @return none
+ **************************************************************************/
+
+void sim_power_cut(){
+    __sim_chips_off();
+    sim_faults.power = 0;
+    sim_faults.off = 0;
+
+    memset(&sim_regs, 0, sizeof(sim_regs));
+    sim_regs.trn = SIM_TRN_EMPTY;
+    sim_master.op = __M_IDLE;
+    sim_master.sda = 1;
+    sim_master.scl = 1;
+    sim_busy = 1;
+    __sim_wire();
+    sim_busy = 0;
+}
+
+/**
+ * @brief Gives the simulated time.
+ *
+ * @return The number of instruction cycles since sim_reset().
+ **************************************************************************/
+
+uint64_t sim_cycles(){
+    return sim_now;
+}
+
+/**
+ * @brief Gives the number of SCL periods on the bus.
+ *
+ * @return The number of rising edges of SCL since sim_reset().
+ **************************************************************************/
+
+uint32_t sim_scl_clocks(){
+    return sim_clocks;
+}
+
+/**
+ * @param dev Device address of the chip.
+ *
+ * @brief Gives direct access to the contents of a chip.
+ *
+ * @return A pointer to the SIM_CHIP_SIZE bytes of the chip.
+ **************************************************************************/
+
+uint8_t *sim_memory(int dev){
+    return sim_chip[dev & 7].memory;
+}
+
+/**
+ * @param dev Device address of the chip.
+ * @param page Page number, the address of the page divided by
+ * SIM_PAGE_SIZE.
+ *
+ * @brief Gives the number of write cycles of a page.
+ *
+ * @return The number of times the page was programmed since sim_reset().
+ **************************************************************************/
+
+uint32_t sim_page_writes(int dev, uint16_t page){
+    return sim_chip[dev & 7].writes[page % (SIM_CHIP_SIZE / SIM_PAGE_SIZE)];
+}
+
+/**
+ * @param dev Device address of the chip.
+ * @param address Address of the byte.
+ *
+ * @brief Gives the number of write cycles of a byte.
+ *
+ * Only the bytes loaded in a page write are counted, since the others
+ * keep their contents through the write cycle.
+ *
+ * @return The number of times the byte was programmed since sim_reset().
+ **************************************************************************/
+
+uint32_t sim_cell_writes(int dev, uint16_t address){
+    return sim_chip[dev & 7].cells[address & (SIM_CHIP_SIZE - 1)];
+}
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file  i2c_sim.h
+ * @brief This file contains the interface of the host I2C EEPROM simulator
+ * @author Jaime Bronozo
+ *
+ * This is a header file for i2c_sim.c which replaces the registers of the
+ * I2C module and the pins of a PIC24 when the libraries are compiled on a
+ * desktop computer. The xc.h in this directory maps every register used
+ * by the EEPROM libraries and Timer1 to the simulator so eeprom.c, the
+ * libraries built on it and ticker.c compile unchanged.
+ *
+ * @date December 13, 2018
+ **************************************************************************/
+
+#ifndef __I2C_SIM_H__
+#define __I2C_SIM_H__
+
+#include <stdint.h>
+
+/**
+ * @def SIM_FAULT_COLLISION
+ *
+ * @brief Another master holds SDA low during a byte.
+ *
+ * @def SIM_FAULT_NACK
+ *
+ * @brief The addressed chip does not acknowledge a byte.
+ *
+ * @def SIM_FAULT_STUCK_SDA
+ *
+ * @brief A chip holds SDA low until SCL is clocked.
+ *
+ * @def SIM_FAULT_STUCK_SCL
+ *
+ * @brief SCL is held low for a number of instruction cycles.
+ *
+ * @def SIM_FAULT_POWER_CUT
+ *
+ * @brief The chips lose power as a byte starts on the bus.
+ **************************************************************************/
+#define SIM_FAULT_COLLISION 0
+#define SIM_FAULT_NACK 1
+#define SIM_FAULT_STUCK_SDA 2
+#define SIM_FAULT_STUCK_SCL 3
+#define SIM_FAULT_POWER_CUT 4
+
+/**
+ * @def SIM_CHIP_SIZE
+ *
+ * @brief Capacity of each simulated 24LC256 in bytes.
+ *
+ * @def SIM_PAGE_SIZE
+ *
+ * @brief Size of the write page of each simulated chip.
+ *
+ * @def SIM_ACCESS_CYCLES
+ *
+ * @brief Instruction cycles counted for each register access.
+ *
+ * The default matches the fastest wait loop on a flag of the I2C module.
+ * The software master spends more cycles between accesses to the pins,
+ * and about 10 gives its real bit rate.
+ **************************************************************************/
+#define SIM_CHIP_SIZE 0x8000
+#define SIM_PAGE_SIZE 64
+
+#ifndef SIM_ACCESS_CYCLES
+#define SIM_ACCESS_CYCLES 3
+#endif
+
+/// @cond
+#define SIM_TRN_EMPTY 0x10000
+
+typedef struct {
+    unsigned SEN:1;
+    unsigned RSEN:1;
+    unsigned PEN:1;
+    unsigned RCEN:1;
+    unsigned ACKEN:1;
+    unsigned ACKDT:1;
+    unsigned STREN:1;
+    unsigned GCEN:1;
+    unsigned SMEN:1;
+    unsigned DISSLW:1;
+    unsigned A10M:1;
+    unsigned IPMIEN:1;
+    unsigned SCLREL:1;
+    unsigned I2CSIDL:1;
+    unsigned :1;
+    unsigned I2CEN:1;
+} I2C1CONBITS;
+
+typedef struct {
+    unsigned TBF:1;
+    unsigned RBF:1;
+    unsigned R_W:1;
+    unsigned S:1;
+    unsigned P:1;
+    unsigned D_A:1;
+    unsigned I2COV:1;
+    unsigned IWCOL:1;
+    unsigned ADD10:1;
+    unsigned GCSTAT:1;
+    unsigned BCL:1;
+    unsigned :3;
+    unsigned TRSTAT:1;
+    unsigned ACKSTAT:1;
+} I2C1STATBITS;
+
+typedef struct {
+    volatile I2C1CONBITS con;
+    volatile I2C1STATBITS stat;
+    volatile unsigned int trn;
+    volatile unsigned int rcv;
+    volatile unsigned int brg;
+    volatile unsigned int flag;
+    volatile unsigned int enable;
+    volatile unsigned int priority;
+} sim_i2c_t;
+
+typedef struct {
+    unsigned :1;
+    unsigned TCS:1;
+    unsigned TSYNC:1;
+    unsigned :1;
+    unsigned TCKPS:2;
+    unsigned TGATE:1;
+    unsigned :6;
+    unsigned TSIDL:1;
+    unsigned :1;
+    unsigned TON:1;
+} T1CONBITS;
+
+typedef struct {
+    volatile T1CONBITS con;
+    volatile unsigned int tmr;
+    volatile unsigned int pr;
+    volatile unsigned int flag;
+    volatile unsigned int enable;
+    volatile unsigned int priority;
+} sim_timer_t;
+
+typedef struct {
+    volatile unsigned int lat[16];
+    volatile unsigned int tris[16];
+    volatile unsigned int port[16];
+} sim_port_t;
+
+sim_i2c_t *sim_i2c();
+sim_port_t *sim_port(int port);
+sim_timer_t *sim_timer();
+volatile unsigned int *sim_rcv();
+/// @endcond
+
+void sim_reset(int chips);
+void sim_step(uint32_t cycles);
+void sim_fault(int fault, uint32_t after);
+void sim_power_cut();
+uint64_t sim_cycles();
+uint32_t sim_scl_clocks();
+uint8_t *sim_memory(int dev);
+uint32_t sim_page_writes(int dev, uint16_t page);
+uint32_t sim_cell_writes(int dev, uint16_t address);
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * @file  libpic30.h
+ * @brief This file replaces the XC16 library header for host builds
+ * @author Jaime Bronozo
+ *
+ * __delay32() steps the simulator in i2c_sim.c by the number of cycles
+ * asked for instead of spinning.
+ *
+ * @date December 13, 2018
+ **************************************************************************/
+
+#ifndef __LIBPIC30_HOST_H__
+#define __LIBPIC30_HOST_H__
+
+void __delay32(unsigned long cycles);
+
+#endif
@@ -0,0 +1,201 @@
+/**
+ * @file  recstore_check.c
+ * @brief This file contains a check of the record store library on the host
+ * @author Jaime Bronozo
+ *
+ * Runs recstore.c on the EEPROM chips of the simulator in i2c_sim.c. Every
+ * update of a record is first attempted with the power cut during the
+ * write cycle, and one update in CHECK_SWEEP before that with the power of
+ * the chips cut at each byte of the write in turn. After every cut the
+ * device is started again with record_begin() and each record must read
+ * back as its last complete version, never as a damaged or unfinished one,
+ * and no other record may appear. The updates go round the ring of slots
+ * twice, past a record written only at the start.
+ *
+ * The check then updates a single record over and over next to a few that
+ * rarely change, and counts the write cycles of every byte of the region.
+ * Since the versions move round the ring, the most worn byte must have
+ * been programmed about as often as the others instead of once per update.
+ *
+ * Built from the root of the toolbox with a host compiler:
+ *
+ * ```
+ * gcc -Ihost -o recstore_check host/recstore_check.c host/i2c_sim.c utilities/eeprom.c utilities/i2c_async.c utilities/recstore.c
+ * ./recstore_check
+ * ```
+ *
+ * @date December 16, 2018
+ **************************************************************************/
+
+// only built by a host compiler, never by XC16
+#ifndef __XC16__
+
+#include <stdio.h>
+#include <string.h>
+
+#define __LIBRECSTORE_SETTINGS
+#include "../utilities/toolbox_settings.h"
+#include "../utilities/i2c_async.h"
+#include "../utilities/eeprom.h"
+#include "../utilities/recstore.h"
+#include "i2c_sim.h"
+
+#define CHECK_KEYS 3
+#define CHECK_UPDATES 300
+#define CHECK_SWEEP 16
+#define CHECK_WEAR_UPDATES 5120
+#define CHECK_SLOTS ((_RECSTORE_END - _RECSTORE_START) / _RECSTORE_SLOT_SIZE)
+
+// where the power is cut, or the byte of the write it is cut at
+#define CHECK_CYCLE -1
+#define CHECK_AFTER -2
+
+typedef struct {
+    uint8_t data[RECORD_DATA_SIZE];
+    int size;
+} check_model_t;
+
+check_model_t check_model[CHECK_KEYS];
+uint32_t check_update = 0;
+uint32_t check_cuts = 0;
+int check_failed = 0;
+
+void __check_fail(const char *what, int key, int cut){
+    if(check_failed < 10 && cut >= 0){
+        printf("update %lu, record %d, cut at byte %d: %s\n",
+                (unsigned long) check_update, key, cut, what);
+    }
+    else if(check_failed < 10){
+        printf("update %lu, record %d, cut %s: %s\n", (unsigned long) check_update,
+                key, cut == CHECK_CYCLE ? "in write cycle" : "after write", what);
+    }
+    check_failed++;
+}
+
+void __check_value(int key, uint8_t *data, int *size){
+    int i;
+
+    *size = 1 + (check_update + key) % RECORD_DATA_SIZE;
+    for(i = 0; i < *size; i++){
+        data[i] = check_update * 13 + key * 7 + i;
+    }
+}
+
+// starts the device again and compares every record with the model
+void __check_restart(int cut){
+    uint8_t buf[RECORD_DATA_SIZE];
+    int key, size, found, written = 0;
+
+    sim_power_cut();
+    check_cuts++;
+    EEPROM_begin();
+    found = record_begin();
+    if(found < 0){
+        __check_fail("record_begin() failed", -1, cut);
+        return;
+    }
+
+    for(key = 0; key < CHECK_KEYS; key++){
+        written += check_model[key].size != 0;
+        size = record_read(key, buf, sizeof(buf));
+        if(size != check_model[key].size
+                || memcmp(buf, check_model[key].data, size) != 0){
+            __check_fail("not the last complete version", key, cut);
+        }
+    }
+
+    // a damaged slot must not show up as a record of another key either
+    if(found != written){
+        __check_fail("records found that were never written", -1, cut);
+    }
+}
+
+void __check_power_cuts(){
+    uint8_t data[RECORD_DATA_SIZE];
+    int key, size, n;
+
+    for(check_update = 0; check_update < CHECK_UPDATES; check_update++){
+        // the last record is written once so the ring has to skip its slot
+        key = check_update ? check_update % (CHECK_KEYS - 1) : CHECK_KEYS - 1;
+        __check_value(key, data, &size);
+
+        // the chips lose power as each byte of the write starts
+        if(check_update % CHECK_SWEEP == 0){
+            for(n = 0; ; n++){
+                sim_fault(SIM_FAULT_POWER_CUT, n);
+                if(record_write(key, data, size) >= 0){
+                    break;
+                }
+                __check_restart(n);
+            }
+        }
+        else if(record_write(key, data, size) < 0){
+            __check_fail("record_write() failed", key, CHECK_CYCLE);
+            continue;
+        }
+
+        // the write went through, so the cut falls in its write cycle
+        __check_restart(CHECK_CYCLE);
+
+        if(record_write(key, data, size) < 0){
+            __check_fail("record_write() failed", key, CHECK_AFTER);
+            continue;
+        }
+        EEPROM_wait_write(_RECSTORE_DEV);
+        memcpy(check_model[key].data, data, size);
+        check_model[key].size = size;
+        __check_restart(CHECK_AFTER);
+    }
+}
+
+void __check_wear(){
+    uint8_t data[RECORD_DATA_SIZE];
+    uint32_t cell, most = 0, least = 0xffffffff, total = 0;
+    uint16_t address;
+    int key, size;
+
+    sim_reset(1);
+    EEPROM_begin();
+    record_begin();
+
+    for(check_update = 0; check_update < CHECK_WEAR_UPDATES; check_update++){
+        key = check_update % 100 ? 0 : 1 + check_update / 100 % (CHECK_KEYS - 1);
+        __check_value(key, data, &size);
+        if(record_write(key, data, size) < 0){
+            __check_fail("record_write() failed", key, CHECK_AFTER);
+        }
+    }
+
+    for(address = _RECSTORE_START; address < _RECSTORE_END; address++){
+        cell = sim_cell_writes(_RECSTORE_DEV, address);
+        total += cell;
+        most = cell > most ? cell : most;
+        least = cell < least ? cell : least;
+    }
+    printf("%lu updates over %d slots, byte write cycles %lu to %lu, mean %lu\n",
+            (unsigned long) CHECK_WEAR_UPDATES, CHECK_SLOTS, (unsigned long) least,
+            (unsigned long) most, (unsigned long) (total / (_RECSTORE_END - _RECSTORE_START)));
+
+    // the ring skips at most CHECK_KEYS live slots on each turn
+    if(most > CHECK_WEAR_UPDATES / (CHECK_SLOTS - CHECK_KEYS) + 1){
+        __check_fail("writes not spread over the region", -1, CHECK_AFTER);
+    }
+}
+
+int main(){
+    sim_reset(1);
+    EEPROM_begin();
+    if(record_begin() != 0){
+        __check_fail("records found on an erased chip", -1, CHECK_AFTER);
+    }
+
+    __check_power_cuts();
+    printf("%lu updates, %lu power cuts\n", (unsigned long) CHECK_UPDATES,
+            (unsigned long) check_cuts);
+    __check_wear();
+
+    printf("%s\n", check_failed ? "FAILED" : "passed");
+    return check_failed != 0;
+}
+
+#endif
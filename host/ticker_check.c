@@ -0,0 +1,185 @@
+/**
+ * @file  ticker_check.c
+ * @brief This file contains a check of the ticker library on the host
+ * @author Jaime Bronozo
+ *
+ * Runs ticker.c on Timer1 of the simulator in i2c_sim.c. The clocks are
+ * compared with the simulated time, and a set of software timers is
+ * started and stopped at random every tick while a plain model of their
+ * expiries is kept alongside. Every timer must expire on the same ticks as
+ * in the model, including periodic timers with periods that are multiples
+ * of the number of slots and timers running many times round the wheel.
+ *
+ * Built from the root of the toolbox with a host compiler:
+ *
+ * ```
+ * gcc -Ihost -o ticker_check host/ticker_check.c host/i2c_sim.c utilities/ticker.c
+ * ./ticker_check
+ * ```
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+// only built by a host compiler, never by XC16
+#ifndef __XC16__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __LIBTICKER_SETTINGS
+#include "../utilities/toolbox_settings.h"
+#include "../utilities/ticker.h"
+#include "i2c_sim.h"
+
+#define CHECK_TIMERS 24
+#define CHECK_TICKS 20000
+
+typedef struct {
+    uint32_t expires;
+    uint32_t period;
+    uint32_t fired;     // expiries since the last start
+    uint32_t taken;     // of which taken with ticker_fired()
+    uint8_t active;
+} check_model_t;
+
+ticker_t check_timer[CHECK_TIMERS];
+check_model_t check_model[CHECK_TIMERS];
+uint32_t check_count = 0;
+uint32_t check_expiries = 0;
+int check_failed = 0;
+
+void __check_fail(const char *what, int i){
+    if(check_failed < 10){
+        printf("tick %lu, timer %d: %s\n", (unsigned long) check_count, i, what);
+    }
+    check_failed++;
+}
+
+void __check_tick(){
+    check_model_t *model;
+    int i;
+
+    // the accesses to the registers take cycles of their own
+    while(ticker_ticks() == check_count){
+        sim_step(100);
+    }
+    check_count++;
+    if(ticker_ticks() != check_count){
+        __check_fail("more than one tick in a step", -1);
+    }
+
+    for(i = 0; i < CHECK_TIMERS; i++){
+        model = &check_model[i];
+        if(model->active && model->expires == check_count){
+            model->fired++;
+            check_expiries++;
+            if(model->period){
+                model->expires += model->period;
+            }
+            else{
+                model->active = 0;
+            }
+        }
+    }
+}
+
+void __check_random_op(){
+    int i = rand() % CHECK_TIMERS;
+    check_model_t *model = &check_model[i];
+    uint32_t delay, period;
+
+    switch(rand() % 8){
+    case 0:
+    case 1:
+        // periods around the number of slots and its multiples
+        delay = rand() % (4 * _TICKER_SLOTS);
+        period = (rand() % 3) ? rand() % (3 * _TICKER_SLOTS) : 0;
+        if(rand() % 4 == 0){
+            period = _TICKER_SLOTS * (1 + rand() % 3);
+        }
+        ticker_start(&check_timer[i], delay, period);
+        model->expires = check_count + delay + 1;
+        model->period = period;
+        model->fired = 0;
+        model->taken = 0;
+        model->active = 1;
+        break;
+    case 2:
+        ticker_stop(&check_timer[i]);
+        model->active = 0;
+        break;
+    default:
+        model->taken += ticker_fired(&check_timer[i]);
+        break;
+    }
+}
+
+void __check_clocks(){
+    uint64_t start;
+    uint32_t us, ms, last = 0, expected;
+    int i;
+
+    ticker_begin();
+    start = sim_cycles();
+    for(i = 0; i < 5000; i++){
+        sim_step(rand() % 3000);
+        us = ticker_us();
+        ms = ticker_ms();
+        expected = (sim_cycles() - start) * 1000000ULL / FCY;
+        if(us < last){
+            __check_fail("ticker_us() went back", -1);
+        }
+        if(us + 5 < expected || us > expected + 5){
+            __check_fail("ticker_us() off the simulated time", -1);
+        }
+        if(ms != us / 1000 && ms + 1 != us / 1000 && ms != us / 1000 + 1){
+            __check_fail("ticker_ms() off ticker_us()", -1);
+        }
+        last = us;
+    }
+    printf("clocks after %.3f s: ticker_us %lu, ticker_ms %lu\n",
+            (double) (sim_cycles() - start) / FCY,
+            (unsigned long) ticker_us(), (unsigned long) ticker_ms());
+}
+
+void __check_wheel(){
+    int i, j;
+
+    ticker_begin();
+    check_count = 0;
+    for(i = 0; i < CHECK_TIMERS; i++){
+        check_timer[i].active = 0;
+        check_model[i].active = 0;
+    }
+
+    for(i = 0; i < CHECK_TICKS; i++){
+        for(j = rand() % 3; j > 0; j--){
+            __check_random_op();
+        }
+        __check_tick();
+        for(j = 0; j < CHECK_TIMERS; j++){
+            if(check_timer[j].active != check_model[j].active){
+                __check_fail("active differs from the model", j);
+            }
+            if(check_model[j].taken + check_timer[j].fired != check_model[j].fired){
+                __check_fail("expiries differ from the model", j);
+            }
+        }
+    }
+
+    printf("wheel of %d slots, %d timers, %d ticks, %lu expiries\n",
+            _TICKER_SLOTS, CHECK_TIMERS, CHECK_TICKS, (unsigned long) check_expiries);
+}
+
+int main(){
+    srand(1);
+    sim_reset(0);
+
+    __check_clocks();
+    __check_wheel();
+
+    printf("%s\n", check_failed ? "FAILED" : "passed");
+    return check_failed != 0;
+}
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * @file  xc.h
+ * @brief This file replaces the device header of XC16 for host builds
+ * @author Jaime Bronozo
+ *
+ * Maps the registers of the I2C module 1, Timer1, their interrupt bits
+ * and the pins of ports A and B to the simulator in i2c_sim.c. Every
+ * access steps the simulator by SIM_ACCESS_CYCLES instruction cycles, so
+ * waits on a flag take as many cycles as the bus needs. Only the
+ * registers used by the EEPROM libraries and the ticker library are
+ * provided.
+ *
+ * @date December 13, 2018
+ **************************************************************************/
+
+#ifndef __XC_HOST_H__
+#define __XC_HOST_H__
+
+#include "i2c_sim.h"
+
+/// @cond
+#define interrupt
+#define no_auto_psv
+
+#define Nop() sim_step(1)
+
+#define I2C1CONbits (sim_i2c()->con)
+#define I2C1STATbits (sim_i2c()->stat)
+#define I2C1TRN (sim_i2c()->trn)
+#define I2C1RCV (*sim_rcv())
+#define I2C1BRG (sim_i2c()->brg)
+#define _MI2C1IF (sim_i2c()->flag)
+#define _MI2C1IE (sim_i2c()->enable)
+#define _MI2C1IP (sim_i2c()->priority)
+
+#define T1CONbits (sim_timer()->con)
+#define TMR1 (sim_timer()->tmr)
+#define PR1 (sim_timer()->pr)
+#define _T1IF (sim_timer()->flag)
+#define _T1IE (sim_timer()->enable)
+#define _T1IP (sim_timer()->priority)
+
+#define _LATA0 (sim_port(0)->lat[0])
+#define _TRISA0 (sim_port(0)->tris[0])
+#define _RA0 (sim_port(0)->port[0])
+#define _LATA1 (sim_port(0)->lat[1])
+#define _TRISA1 (sim_port(0)->tris[1])
+#define _RA1 (sim_port(0)->port[1])
+#define _LATA2 (sim_port(0)->lat[2])
+#define _TRISA2 (sim_port(0)->tris[2])
+#define _RA2 (sim_port(0)->port[2])
+#define _LATA3 (sim_port(0)->lat[3])
+#define _TRISA3 (sim_port(0)->tris[3])
+#define _RA3 (sim_port(0)->port[3])
+#define _LATA4 (sim_port(0)->lat[4])
+#define _TRISA4 (sim_port(0)->tris[4])
+#define _RA4 (sim_port(0)->port[4])
+#define _LATA5 (sim_port(0)->lat[5])
+#define _TRISA5 (sim_port(0)->tris[5])
+#define _RA5 (sim_port(0)->port[5])
+#define _LATA6 (sim_port(0)->lat[6])
+#define _TRISA6 (sim_port(0)->tris[6])
+#define _RA6 (sim_port(0)->port[6])
+#define _LATA7 (sim_port(0)->lat[7])
+#define _TRISA7 (sim_port(0)->tris[7])
+#define _RA7 (sim_port(0)->port[7])
+#define _LATA8 (sim_port(0)->lat[8])
+#define _TRISA8 (sim_port(0)->tris[8])
+#define _RA8 (sim_port(0)->port[8])
+#define _LATA9 (sim_port(0)->lat[9])
+#define _TRISA9 (sim_port(0)->tris[9])
+#define _RA9 (sim_port(0)->port[9])
+#define _LATA10 (sim_port(0)->lat[10])
+#define _TRISA10 (sim_port(0)->tris[10])
+#define _RA10 (sim_port(0)->port[10])
+#define _LATA11 (sim_port(0)->lat[11])
+#define _TRISA11 (sim_port(0)->tris[11])
+#define _RA11 (sim_port(0)->port[11])
+#define _LATA12 (sim_port(0)->lat[12])
+#define _TRISA12 (sim_port(0)->tris[12])
+#define _RA12 (sim_port(0)->port[12])
+#define _LATA13 (sim_port(0)->lat[13])
+#define _TRISA13 (sim_port(0)->tris[13])
+#define _RA13 (sim_port(0)->port[13])
+#define _LATA14 (sim_port(0)->lat[14])
+#define _TRISA14 (sim_port(0)->tris[14])
+#define _RA14 (sim_port(0)->port[14])
+#define _LATA15 (sim_port(0)->lat[15])
+#define _TRISA15 (sim_port(0)->tris[15])
+#define _RA15 (sim_port(0)->port[15])
+
+#define _LATB0 (sim_port(1)->lat[0])
+#define _TRISB0 (sim_port(1)->tris[0])
+#define _RB0 (sim_port(1)->port[0])
+#define _LATB1 (sim_port(1)->lat[1])
+#define _TRISB1 (sim_port(1)->tris[1])
+#define _RB1 (sim_port(1)->port[1])
+#define _LATB2 (sim_port(1)->lat[2])
+#define _TRISB2 (sim_port(1)->tris[2])
+#define _RB2 (sim_port(1)->port[2])
+#define _LATB3 (sim_port(1)->lat[3])
+#define _TRISB3 (sim_port(1)->tris[3])
+#define _RB3 (sim_port(1)->port[3])
+#define _LATB4 (sim_port(1)->lat[4])
+#define _TRISB4 (sim_port(1)->tris[4])
+#define _RB4 (sim_port(1)->port[4])
+#define _LATB5 (sim_port(1)->lat[5])
+#define _TRISB5 (sim_port(1)->tris[5])
+#define _RB5 (sim_port(1)->port[5])
+#define _LATB6 (sim_port(1)->lat[6])
+#define _TRISB6 (sim_port(1)->tris[6])
+#define _RB6 (sim_port(1)->port[6])
+#define _LATB7 (sim_port(1)->lat[7])
+#define _TRISB7 (sim_port(1)->tris[7])
+#define _RB7 (sim_port(1)->port[7])
+#define _LATB8 (sim_port(1)->lat[8])
+#define _TRISB8 (sim_port(1)->tris[8])
+#define _RB8 (sim_port(1)->port[8])
+#define _LATB9 (sim_port(1)->lat[9])
+#define _TRISB9 (sim_port(1)->tris[9])
+#define _RB9 (sim_port(1)->port[9])
+#define _LATB10 (sim_port(1)->lat[10])
+#define _TRISB10 (sim_port(1)->tris[10])
+#define _RB10 (sim_port(1)->port[10])
+#define _LATB11 (sim_port(1)->lat[11])
+#define _TRISB11 (sim_port(1)->tris[11])
+#define _RB11 (sim_port(1)->port[11])
+#define _LATB12 (sim_port(1)->lat[12])
+#define _TRISB12 (sim_port(1)->tris[12])
+#define _RB12 (sim_port(1)->port[12])
+#define _LATB13 (sim_port(1)->lat[13])
+#define _TRISB13 (sim_port(1)->tris[13])
+#define _RB13 (sim_port(1)->port[13])
+#define _LATB14 (sim_port(1)->lat[14])
+#define _TRISB14 (sim_port(1)->tris[14])
+#define _RB14 (sim_port(1)->port[14])
+#define _LATB15 (sim_port(1)->lat[15])
+#define _TRISB15 (sim_port(1)->tris[15])
+#define _RB15 (sim_port(1)->port[15])
+
+/// @endcond
+
+#endif
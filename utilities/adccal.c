@@ -0,0 +1,281 @@
+/**
+ * @file  adccal.c
+ * @brief This file contains function wrappers for calibrated ADC readings
+ * @author Jaime Bronozo
+ *
+ * This is a library for converting raw readings from adcread.c into
+ * engineering units. Each channel has its own offset and gain correction,
+ * the supply voltage can be measured against the internal band gap
+ * reference and thermistor readings are converted through a lookup table
+ * that is generated by the compiler from the thermistor parameters found
+ * in toolbox_settings.h.
+ *
+ * All of the conversions that are done on every reading only use
+ * multiplication, shifts and additions. The only division is done once
+ * inside ADC_calibrate_supply().
+ *
+ * @date November 24, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBADCCAL_SETTINGS
+
+#include "toolbox_settings.h"
+#include "adcread.h"
+#include "adccal.h"
+
+#if __LIBADCCAL_DISABLE != 1
+
+#if __LIBADCREAD_DISABLE == 1
+#error "adccal.c requires the adcread library to be enabled"
+#endif
+
+/*
+ * Compile time natural logarithm. The argument is first reduced to the
+ * range [1, 2) by powers of two and the remainder is evaluated using the
+ * first four terms of the series ln(m) = 2 atanh((m - 1) / (m + 1)), which
+ * is accurate to about 3e-5 in that range. Valid for 2^-10 < x < 2^10.
+ */
+#define __LN2 0.69314718055994531
+#define __LNZ(z) (2.0 * (z) * (1.0 + (z) * (z) * (1.0 / 3 + (z) * (z) * \
+        (1.0 / 5 + (z) * (z) / 7))))
+#define __LNM(m) __LNZ(((m) - 1.0) / ((m) + 1.0))
+#define __LNP(y) ((y) >= 512 ? 9 * __LN2 + __LNM((y) / 512) : \
+        (y) >= 256 ? 8 * __LN2 + __LNM((y) / 256) : \
+        (y) >= 128 ? 7 * __LN2 + __LNM((y) / 128) : \
+        (y) >= 64 ? 6 * __LN2 + __LNM((y) / 64) : \
+        (y) >= 32 ? 5 * __LN2 + __LNM((y) / 32) : \
+        (y) >= 16 ? 4 * __LN2 + __LNM((y) / 16) : \
+        (y) >= 8 ? 3 * __LN2 + __LNM((y) / 8) : \
+        (y) >= 4 ? 2 * __LN2 + __LNM((y) / 4) : \
+        (y) >= 2 ? __LN2 + __LNM((y) / 2) : __LNM(y))
+#define __LN(x) ((x) < 1 ? -__LNP(1.0 / (x)) : __LNP(x))
+
+/*
+ * Thermistor temperature in tenths of a degree Celsius for a given ADC
+ * count using the beta equation. The thermistor is assumed to be on the
+ * ground side of a divider with _ADC_NTC_SERIES to Vdd.
+ */
+#define __NTC_RATIO(c) (((double) _ADC_NTC_SERIES * (c)) / \
+        ((double) _ADC_NTC_R0 * (1024 - (c))))
+#define __NTC_KELVIN(c) (1.0 / (1.0 / 298.15 + \
+        __LN(__NTC_RATIO(c)) / _ADC_NTC_BETA))
+#define __NTC(c) ((int16_t) ((__NTC_KELVIN(c) - 273.15) * 10 + 10000.5) \
+        - 10000)
+/// @endcond
+
+/**
+ * @brief Thermistor lookup table.
+ *
+ * Temperatures in tenths of a degree Celsius for every 32 ADC counts. The
+ * first and last entries are evaluated at 16 and 1008 instead of 0 and
+ * 1024 since the thermistor resistance is either zero or infinite at the
+ * ends, so the two end segments only span 16 counts.
+ **************************************************************************/
+static const int16_t adccal_ntc_table[33] = {
+    __NTC(16),  __NTC(32),  __NTC(64),  __NTC(96),
+    __NTC(128), __NTC(160), __NTC(192), __NTC(224),
+    __NTC(256), __NTC(288), __NTC(320), __NTC(352),
+    __NTC(384), __NTC(416), __NTC(448), __NTC(480),
+    __NTC(512), __NTC(544), __NTC(576), __NTC(608),
+    __NTC(640), __NTC(672), __NTC(704), __NTC(736),
+    __NTC(768), __NTC(800), __NTC(832), __NTC(864),
+    __NTC(896), __NTC(928), __NTC(960), __NTC(992),
+    __NTC(1008)
+};
+
+int16_t adccal_offset[_ADC_CAL_CHANNELS];
+uint16_t adccal_gain[_ADC_CAL_CHANNELS];
+uint8_t adccal_ready = 0;
+
+/**
+ * @brief Millivolt scaling factor.
+ *
+ * Stores the supply voltage in millivolts multiplied by 64 so that a
+ * 10-bit reading is converted to millivolts with a single multiplication
+ * and a 16-bit shift.
+ **************************************************************************/
+uint32_t adccal_mv_scale = ((uint32_t) _ADC_SUPPLY_MV) << 6;
+
+void __adccal_init(){
+    int i;
+    for(i = 0; i < _ADC_CAL_CHANNELS; i++){
+        adccal_offset[i] = 0;
+        adccal_gain[i] = ADC_GAIN_UNITY;
+    }
+    adccal_ready = 1;
+}
+
+/**
+ * @param channel Analog pin number.
+ * @param offset Raw count subtracted from every reading of the channel.
+ * @param gain Gain applied after the offset in Q2.14 format. Use
+ * ADC_GAIN() to convert from a constant.
+ *
+ * @brief Sets the correction values of a channel.
+ *
+ * Stores the offset and gain correction used by ADC_corrected() and the
+ * functions built on top of it. Channels that are never calibrated use a
+ * zero offset and a gain of #ADC_GAIN_UNITY.
+ *
+ * @return none
+ **************************************************************************/
+
+void ADC_calibrate(uint8_t channel, int16_t offset, uint16_t gain){
+    if(!adccal_ready){
+        __adccal_init();
+    }
+    if(channel >= _ADC_CAL_CHANNELS){
+        return;
+    }
+    adccal_offset[channel] = offset;
+    adccal_gain[channel] = gain;
+}
+
+/**
+ * @brief Measures the supply voltage against the band gap reference.
+ *
+ * Reads the internal band gap reference channel and computes the supply
+ * voltage from the known reference voltage. The result is used by all
+ * millivolt conversions from this point on. Call this once after
+ * ADC_begin() and again whenever the supply is expected to have drifted.
+ *
+ * @return The measured supply voltage in millivolts or 0 if the band gap
+ * reading is invalid, in which case the previous value is kept.
+ *
+ * @note This is the only function of the library that uses a division.
+ **************************************************************************/
+
+uint16_t ADC_calibrate_supply(){
+    uint16_t raw;
+    uint32_t mv;
+
+    // discard the first conversion while the reference settles
+    analogRead(_ADC_VBG_CHANNEL);
+    raw = analogRead(_ADC_VBG_CHANNEL);
+    if(raw == 0 || raw >= 1023){
+        return 0;
+    }
+
+    mv = (((uint32_t) _ADC_VBG_MV << 10) + (raw >> 1)) / raw;
+    adccal_mv_scale = mv << 6;
+    return mv;
+}
+
+/**
+ * @brief Gives the supply voltage used for conversions.
+ *
+ * @return The supply voltage in millivolts, either measured through
+ * ADC_calibrate_supply() or _ADC_SUPPLY_MV if it was never called.
+ **************************************************************************/
+
+uint16_t ADC_supply_mv(){
+    return adccal_mv_scale >> 6;
+}
+
+/**
+ * @param channel Analog pin number the reading came from.
+ * @param raw Raw reading from analogRead().
+ *
+ * @brief Applies the channel offset and gain to a reading.
+ *
+ * @return The corrected reading, clamped to 0-1023.
+ **************************************************************************/
+
+uint16_t ADC_corrected(uint8_t channel, uint16_t raw){
+    int32_t value;
+    if(!adccal_ready || channel >= _ADC_CAL_CHANNELS){
+        return raw;
+    }
+
+    value = (int32_t) raw - adccal_offset[channel];
+    if(value <= 0){
+        return 0;
+    }
+    value = (value * adccal_gain[channel]) >> 14;
+    return (value > 1023) ? 1023 : value;
+}
+
+/**
+ * @param raw A 10-bit reading.
+ *
+ * @brief Converts a reading to millivolts.
+ *
+ * @return The voltage of the reading in millivolts relative to the supply
+ * voltage set by ADC_calibrate_supply().
+ **************************************************************************/
+
+uint16_t ADC_to_mv(uint16_t raw){
+    return ((uint32_t) raw * adccal_mv_scale) >> 16;
+}
+
+/**
+ * @param raw A 10-bit reading from the thermistor divider.
+ *
+ * @brief Converts a thermistor reading to a temperature.
+ *
+ * Interpolates linearly between the two nearest entries of the lookup
+ * table generated from _ADC_NTC_BETA, _ADC_NTC_R0 and _ADC_NTC_SERIES.
+ * Since the divider is ratiometric, the result does not depend on the
+ * supply voltage. Readings below 16 or above 1008 give the temperature at
+ * 16 or 1008.
+ *
+ * @return The temperature in tenths of a degree Celsius.
+ **************************************************************************/
+
+int16_t ADC_to_celsius(uint16_t raw){
+    uint16_t index, fraction;
+    int16_t low, high;
+
+    if(raw < 16){
+        raw = 16;
+    }
+    else if(raw > 1008){
+        raw = 1008;
+    }
+
+    // the end segments run from 16 to 32 and from 992 to 1008
+    if(raw < 32 || raw >= 992){
+        index = (raw < 32) ? 0 : 31;
+        fraction = raw - ((raw < 32) ? 16 : 992);
+        low = adccal_ntc_table[index];
+        high = adccal_ntc_table[index + 1];
+        return low + (((int32_t) (high - low) * fraction) >> 4);
+    }
+
+    index = raw >> 5;
+    fraction = raw & 31;
+    low = adccal_ntc_table[index];
+    high = adccal_ntc_table[index + 1];
+    return low + (((int32_t) (high - low) * fraction) >> 5);
+}
+
+/**
+ * @param channel Analog pin number.
+ *
+ * @brief Reads the specified analog pin in millivolts.
+ *
+ * Combines analogRead(), ADC_corrected() and ADC_to_mv().
+ *
+ * @return The calibrated voltage of the pin in millivolts.
+ **************************************************************************/
+
+uint16_t analogRead_mv(uint8_t channel){
+    return ADC_to_mv(ADC_corrected(channel, analogRead(channel)));
+}
+
+/**
+ * @param channel Analog pin number connected to the thermistor divider.
+ *
+ * @brief Reads the temperature of a thermistor.
+ *
+ * Combines analogRead(), ADC_corrected() and ADC_to_celsius().
+ *
+ * @return The temperature in tenths of a degree Celsius.
+ **************************************************************************/
+
+int16_t analogRead_celsius(uint8_t channel){
+    return ADC_to_celsius(ADC_corrected(channel, analogRead(channel)));
+}
+
+#endif
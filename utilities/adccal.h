@@ -0,0 +1,45 @@
+/**
+ * @file  adccal.h
+ * @brief This file contains function wrappers for calibrated ADC readings
+ * @author Jaime Bronozo
+ *
+ * This is a header file for adccal.c which must be included to any source
+ * files that require conversion of analog readings to engineering units.
+ * This library is dynamically included in the main header PIC24_toolbox.h
+ *
+ * @date November 24, 2018
+ **************************************************************************/
+
+#ifndef __ADCCAL_TOOLBOX_H__
+#define __ADCCAL_TOOLBOX_H__
+
+/**
+ * @def ADC_GAIN_UNITY
+ *
+ * @brief Gain value that leaves the reading unchanged.
+ *
+ * Channel gains are unsigned fixed point numbers with 14 fractional bits
+ * (Q2.14) so that gains from 0 to just under 4 can be represented. Use
+ * ADC_GAIN(x) to convert a constant to this format.
+ *
+ * @def ADC_GAIN(x)
+ * @param x Gain as a floating point constant.
+ *
+ * @brief Converts a constant gain to its Q2.14 representation.
+ *
+ * This is folded by the compiler when used with constants so no floating
+ * point code is generated.
+ **************************************************************************/
+#define ADC_GAIN_UNITY 0x4000
+#define ADC_GAIN(x) ((uint16_t) ((x) * ADC_GAIN_UNITY + 0.5))
+
+void ADC_calibrate(uint8_t channel, int16_t offset, uint16_t gain);
+uint16_t ADC_calibrate_supply();
+uint16_t ADC_supply_mv();
+uint16_t ADC_corrected(uint8_t channel, uint16_t raw);
+uint16_t ADC_to_mv(uint16_t raw);
+int16_t ADC_to_celsius(uint16_t raw);
+uint16_t analogRead_mv(uint8_t channel);
+int16_t analogRead_celsius(uint8_t channel);
+
+#endif
@@ -11,6 +11,10 @@
  * the configuration file toolbox_settings.h in order to set the proper
  * flags to the module.
  * 
+ * The monitoring mode scans its channels at _ADC_MONITOR_SPS, with each
+ * conversion started by a period match of Timer3, so Timer3 must not be
+ * used elsewhere while it runs.
+ * 
  * @date November 19, 2018
  **************************************************************************/
 
@@ -23,6 +27,144 @@
 #if __LIBADCREAD_DISABLE != 1
 /// @endcond
 
+/// @cond
+#define _ADC_SCAN_MAX 16
+#define _ADC_CONVERT_TAD 12
+
+/*
+ * Cycle counts of the minimum TAD and of the time needed to charge the
+ * sample and hold capacitor to within half an LSB through the source,
+ * interconnect and sampling switch resistances (t = C R ln(2^11)).
+ */
+#define __ADC_TAD_CYCLES ((_ADC_TAD_MIN_NS * 1ULL * FCY + 999999999ULL) \
+        / 1000000000ULL)
+#define __ADC_ACQ_FS (_ADC_CHOLD_FF * 1ULL * (_ADC_RIC_OHMS + \
+        _ADC_RSS_OHMS + _ADC_SOURCE_OHMS) * 76246ULL / 10000ULL)
+#define __ADC_ACQ_CYCLES ((__ADC_ACQ_FS * FCY + 999999999999999ULL) \
+        / 1000000000000000ULL)
+
+// shortest legal TAD unless the sampling time would not fit in SAMC
+#ifndef _ADC_PERIOD
+#if __ADC_TAD_CYCLES * 31 >= __ADC_ACQ_CYCLES
+#define _ADC_PERIOD (__ADC_TAD_CYCLES - 1)
+#else
+#define _ADC_PERIOD ((__ADC_ACQ_CYCLES + 30) / 31 - 1)
+#endif
+#endif
+
+// sampling long enough to charge the capacitor and to keep the
+// throughput at or below the rating of the converter
+#define __ADC_SAMPLE_ACQ ((__ADC_ACQ_CYCLES + _ADC_PERIOD) / (_ADC_PERIOD + 1))
+#define __ADC_SAMPLE_MAX ((FCY + (_ADC_PERIOD + 1LL) * _ADC_MAX_SPS - 1) \
+        / ((_ADC_PERIOD + 1LL) * _ADC_MAX_SPS) - _ADC_CONVERT_TAD)
+
+#ifndef _SAMPLE_PERIOD
+#if __ADC_SAMPLE_ACQ >= __ADC_SAMPLE_MAX && __ADC_SAMPLE_ACQ > 1
+#define _SAMPLE_PERIOD __ADC_SAMPLE_ACQ
+#elif __ADC_SAMPLE_MAX > 1
+#define _SAMPLE_PERIOD __ADC_SAMPLE_MAX
+#else
+#define _SAMPLE_PERIOD 1
+#endif
+#endif
+
+#define __ADC_SPS (FCY / ((_ADC_PERIOD + 1ULL) * \
+        (_SAMPLE_PERIOD + _ADC_CONVERT_TAD)))
+
+#if _ADC_PERIOD + 1 < __ADC_TAD_CYCLES
+#error "_ADC_PERIOD gives a TAD shorter than _ADC_TAD_MIN_NS"
+#endif
+#if _ADC_PERIOD > 255
+#error "FCY is too high for the ADC clock divider"
+#endif
+#if _SAMPLE_PERIOD < 1 || _SAMPLE_PERIOD > 31
+#error "_SAMPLE_PERIOD must be from 1 to 31 TAD"
+#endif
+#if _SAMPLE_PERIOD * (_ADC_PERIOD + 1) < __ADC_ACQ_CYCLES
+#warning "_SAMPLE_PERIOD is too short for _ADC_SOURCE_OHMS"
+#endif
+#if __ADC_SPS < _ADC_TARGET_SPS
+#error "_ADC_TARGET_SPS cannot be met with _ADC_SOURCE_OHMS at this FCY"
+#endif
+#if __ADC_SPS > _ADC_MAX_SPS
+#error "the ADC timing gives more than _ADC_MAX_SPS samples per second"
+#endif
+
+#if (_ADC_EVENT_QUEUE & (_ADC_EVENT_QUEUE - 1)) != 0
+#error "_ADC_EVENT_QUEUE must be a power of two"
+#endif
+
+// every conversion of a full scan still needs its sampling time
+#if _ADC_MONITOR_SPS < 1 || _ADC_MONITOR_SPS * 1ULL * _ADC_SCAN_MAX > __ADC_SPS
+#error "_ADC_MONITOR_SPS is too high for the ADC timing"
+#endif
+
+#define __ADC_SCAN_CYCLES ((FCY) * 1ULL / _ADC_MONITOR_SPS)
+
+// the smallest prescaler that fits a scan of one channel in Timer3
+#if __ADC_SCAN_CYCLES <= 0x10000ULL
+#define __ADC_TCKPS 0
+#define __ADC_SCAN_PERIOD (__ADC_SCAN_CYCLES)
+#elif __ADC_SCAN_CYCLES / 8 <= 0x10000ULL
+#define __ADC_TCKPS 1
+#define __ADC_SCAN_PERIOD (__ADC_SCAN_CYCLES / 8)
+#elif __ADC_SCAN_CYCLES / 64 <= 0x10000ULL
+#define __ADC_TCKPS 2
+#define __ADC_SCAN_PERIOD (__ADC_SCAN_CYCLES / 64)
+#else
+#define __ADC_TCKPS 3
+#define __ADC_SCAN_PERIOD (__ADC_SCAN_CYCLES / 256)
+#endif
+
+#if __ADC_SCAN_PERIOD > 0x10000ULL
+#error "_ADC_MONITOR_SPS cannot be made with Timer3 at this FCY"
+#endif
+/// @endcond
+
+/**
+ * @brief Threshold settings and state of a monitored channel.
+ *
+ * Internal structure used by the monitoring mode to store the window of a
+ * channel and the zone it was last seen in.
+ **************************************************************************/
+typedef struct {
+    uint16_t low;
+    uint16_t high;
+    uint16_t hysteresis;
+    uint8_t enabled;
+    uint8_t zone;
+} adc_window_t;
+
+adc_window_t adc_window[_ADC_SCAN_MAX];
+uint8_t adc_scan_channel[_ADC_SCAN_MAX];
+uint8_t adc_scan_count = 0;
+volatile uint16_t adc_scan_value[_ADC_SCAN_MAX];
+volatile uint8_t adc_monitoring = 0;
+adc_hook_t adc_hook[_ADC_HOOKS];
+
+adc_event_t adc_event_queue[_ADC_EVENT_QUEUE];
+volatile uint8_t adc_event_head = 0;
+volatile uint8_t adc_event_tail = 0;
+volatile uint16_t adc_event_lost = 0;
+int16_t adc_request = -1;
+
+/**
+ * @brief Conversion rate of the ADC.
+ *
+ * Number of samples per second that the ADC produces when sampling
+ * continuously with the timing computed from toolbox_settings.h. This is
+ * the fastest rate of back to back calls to analogRead().
+ **************************************************************************/
+const uint32_t adc_sample_rate = __ADC_SPS;
+
+/**
+ * @brief Scan rate of the monitoring mode.
+ *
+ * Number of scans per second, set by _ADC_MONITOR_SPS. Every channel in
+ * the scan is sampled at this rate whatever the number of channels.
+ **************************************************************************/
+const uint32_t adc_monitor_rate = _ADC_MONITOR_SPS;
+
 
 /**
  * @brief Sets up the nexessary values to read analog values.
@@ -41,6 +183,61 @@ void ADC_begin(){
     AD1CON1bits.ADON = 1;
 }
 
+uint16_t __adc_convert(unsigned short pin){
+    AD1CHSbits.CH0SA = pin;
+    AD1CON1bits.SAMP = 1;
+    while(!AD1CON1bits.DONE);
+    AD1CON1bits.DONE = 0;
+    return ADC1BUF0;
+}
+
+void __adc_monitor_start(uint8_t resume){
+    int i;
+    uint16_t scan = 0;
+
+    adc_scan_count = 0;
+    for(i = 0; i < _ADC_SCAN_MAX; i++){
+        if(adc_window[i].enabled){
+            adc_scan_channel[adc_scan_count++] = i;
+            // a scan paused by analogRead() keeps its latest values
+            if(!resume){
+                adc_scan_value[i] = 0;
+            }
+            scan |= 1 << i;
+        }
+    }
+    if(!adc_scan_count){
+        adc_monitoring = 0;
+        return;
+    }
+
+    AD1CON1bits.ADON = 0;
+    T3CONbits.TON = 0;
+    T3CONbits.TCS = 0;
+    T3CONbits.TGATE = 0;
+    T3CONbits.TCKPS = __ADC_TCKPS;
+    TMR3 = 0;
+    // a period match converts the next channel of the scan
+    PR3 = __ADC_SCAN_PERIOD / adc_scan_count - 1;
+
+    AD1CON1bits.SSRC = 2;
+    AD1CSSL = scan;
+    AD1CON2bits.CSCNA = 1;
+    AD1CON2bits.SMPI = adc_scan_count - 1;
+    // a split buffer is filled in one half while the other is read
+    AD1CON2bits.BUFM = adc_scan_count <= 8;
+    AD1CON1bits.ASAM = 1;
+
+    _AD1IF = 0;
+#if __LIBADCREAD_ISR == 1
+    _AD1IP = _ADC_ISR_PRIORITY;
+    _AD1IE = 1;
+#endif
+    adc_monitoring = 1;
+    AD1CON1bits.ADON = 1;
+    T3CONbits.TON = 1;
+}
+
 /**
  * @param pin Analog pin number.
  * 
@@ -50,15 +247,361 @@ void ADC_begin(){
  * ground. This assumes that the pin is set up for usage as an analog
  * reading pin (by setting the ADC pin configuration and digital pin mode).
  * 
+ * While the monitoring mode is running, channels that are being scanned
+ * return their latest scanned value immediately. Other channels pause the
+ * scan for a single conversion.
+ * 
  * @return A value from 0-1023 proportional to Vdd and ground.
  **************************************************************************/
 
 uint16_t analogRead(unsigned short pin){
+    uint16_t value;
+    if(!adc_monitoring){
+        return __adc_convert(pin);
+    }
+    if(pin < _ADC_SCAN_MAX && adc_window[pin].enabled){
+        return adc_scan_value[pin];
+    }
+
+    ADC_monitor_end();
+    value = __adc_convert(pin);
+    __adc_monitor_start(1);
+    return value;
+}
+
+/**
+ * @param pin Analog pin number.
+ * 
+ * @brief Starts reading the specified analog pin without waiting.
+ * 
+ * The non-blocking counterpart of analogRead(), for use from a task of
+ * the scheduler library. The value is taken with ADC_service() once the
+ * conversion is done. Only one read can be in progress, and analogRead()
+ * or ADC_monitor_begin() must not be called until it is taken.
+ * 
+ * While the monitoring mode is running, only channels that are being
+ * scanned can be read this way since pausing the scan would have to wait.
+ * 
+ * @return 0 if the read was started or -1 if it cannot be started now.
+ **************************************************************************/
+
+int ADC_start(unsigned short pin){
+    if(adc_request >= 0){
+        return -1;
+    }
+    if(adc_monitoring){
+        if(pin < _ADC_SCAN_MAX && adc_window[pin].enabled){
+            adc_request = pin;
+            return 0;
+        }
+        return -1;
+    }
+    AD1CON1bits.DONE = 0;
     AD1CHSbits.CH0SA = pin;
     AD1CON1bits.SAMP = 1;
-    while(!AD1CON1bits.DONE);
+    adc_request = pin;
+    return 0;
+}
+
+/**
+ * @brief Takes the value of the read started by ADC_start().
+ * 
+ * Only looks at the ADC once and returns at once.
+ * 
+ * @return A value from 0-1023 proportional to Vdd and ground, or -1 if
+ * the conversion is not done yet or no read was started.
+ **************************************************************************/
+
+int ADC_service(){
+    int value;
+
+    if(adc_request < 0){
+        return -1;
+    }
+    if(adc_monitoring){
+        value = adc_scan_value[adc_request];
+    }
+    else if(!AD1CON1bits.DONE){
+        return -1;
+    }
+    else{
+        AD1CON1bits.DONE = 0;
+        value = ADC1BUF0;
+    }
+    adc_request = -1;
+    return value;
+}
+
+void __adc_event_push(uint8_t channel, uint8_t type, uint16_t value){
+    uint8_t next = (adc_event_head + 1) & (_ADC_EVENT_QUEUE - 1);
+    if(next == adc_event_tail){
+        adc_event_lost++;
+        return;
+    }
+    adc_event_queue[adc_event_head].channel = channel;
+    adc_event_queue[adc_event_head].type = type;
+    adc_event_queue[adc_event_head].value = value;
+    adc_event_head = next;
+}
+
+void __adc_window_check(uint8_t channel, uint16_t value){
+    adc_window_t *window = &adc_window[channel];
+    uint8_t zone = window->zone;
+
+    if(value > window->high){
+        zone = ADC_EVENT_HIGH;
+    }
+    else if(value < window->low){
+        zone = ADC_EVENT_LOW;
+    }
+    else if(zone == ADC_EVENT_HIGH){
+        // must drop below the high threshold by the hysteresis to return
+        if((uint32_t) value + window->hysteresis < window->high){
+            zone = ADC_EVENT_NORMAL;
+        }
+    }
+    else if(zone == ADC_EVENT_LOW){
+        if(value > (uint32_t) window->low + window->hysteresis){
+            zone = ADC_EVENT_NORMAL;
+        }
+    }
+
+    if(zone != window->zone){
+        window->zone = zone;
+        __adc_event_push(channel, zone, value);
+    }
+}
+
+/**
+ * @param channel Analog pin number.
+ * @param low Readings below this value raise an #ADC_EVENT_LOW event.
+ * @param high Readings above this value raise an #ADC_EVENT_HIGH event.
+ * @param hysteresis Amount a reading must move back inside the window
+ * before an #ADC_EVENT_NORMAL event is raised.
+ * 
+ * @brief Adds a channel to the monitoring mode.
+ * 
+ * Sets the window of a channel to be checked on every scan once
+ * ADC_monitor_begin() is called. Calling this again for the same channel
+ * replaces its window. If the monitoring mode is already running, the
+ * scan is restarted to include the channel.
+ * 
+ * @return 0 on success or -1 if the channel cannot be scanned.
+ **************************************************************************/
+
+int ADC_monitor(uint8_t channel, uint16_t low, uint16_t high, uint16_t hysteresis){
+    uint8_t restart = adc_monitoring;
+    if(channel >= _ADC_SCAN_MAX){
+        return -1;
+    }
+
+    if(restart){
+        ADC_monitor_end();
+    }
+    adc_window[channel].low = low;
+    adc_window[channel].high = high;
+    adc_window[channel].hysteresis = hysteresis;
+    adc_window[channel].zone = ADC_EVENT_NORMAL;
+    adc_window[channel].enabled = 1;
+
+    if(restart){
+        ADC_monitor_begin();
+    }
+    return 0;
+}
+
+/**
+ * @param channel Analog pin number.
+ * 
+ * @brief Adds a channel to the scan without thresholds.
+ * 
+ * Includes the channel in the monitoring mode so that its samples reach
+ * the function attached with ADC_attach() and analogRead() returns its
+ * latest value without converting. The window of a channel that is
+ * already monitored is kept.
+ * 
+ * @return 0 on success or -1 if the channel cannot be scanned.
+ **************************************************************************/
+
+int ADC_scan(uint8_t channel){
+    if(channel >= _ADC_SCAN_MAX){
+        return -1;
+    }
+    if(adc_window[channel].enabled){
+        return 0;
+    }
+    return ADC_monitor(channel, 0, 0xffff, 0);
+}
+
+/**
+ * @param hook Function to be called for every sample.
+ * 
+ * @brief Attaches a function to the scanned samples.
+ * 
+ * The function is called from inside the ADC interrupt once for every
+ * channel of every scan, in increasing channel order, after the
+ * thresholds have been checked. Up to _ADC_HOOKS functions can be
+ * attached at the same time. Attaching a function twice has no effect.
+ * 
+ * @return 0 on success or -1 if there is no free slot.
+ **************************************************************************/
+
+int ADC_attach(adc_hook_t hook){
+    int i, slot = -1;
+    for(i = _ADC_HOOKS - 1; i >= 0; i--){
+        if(adc_hook[i] == hook){
+            return 0;
+        }
+        if(!adc_hook[i]){
+            slot = i;
+        }
+    }
+    if(slot < 0){
+        return -1;
+    }
+    adc_hook[slot] = hook;
+    return 0;
+}
+
+/**
+ * @param hook Function to be detached.
+ * 
+ * @brief Detaches a function attached with ADC_attach().
+ * 
+ * @return none
+ **************************************************************************/
+
+void ADC_detach(adc_hook_t hook){
+    int i;
+    for(i = 0; i < _ADC_HOOKS; i++){
+        if(adc_hook[i] == hook){
+            adc_hook[i] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Starts scanning the monitored channels.
+ * 
+ * Reconfigures the ADC set up by ADC_begin() to scan every channel added
+ * through ADC_monitor() _ADC_MONITOR_SPS times a second, paced by Timer3.
+ * The thresholds are checked after every scan and crossings are queued to
+ * be read with ADC_event().
+ * 
+ * Up to 8 channels are scanned into one half of the ADC buffer while the
+ * interrupt reads the other. A scan of more channels uses the whole
+ * buffer, and the interrupt must then start within one conversion period
+ * of 1 / (_ADC_MONITOR_SPS * channels) seconds to read it in time.
+ * 
+ * @return none
+ * 
+ * @note If __LIBADCREAD_ISR is set to 0, the function ADC_update() must be
+ * called inside the _ADC1Interrupt() subroutine.
+ **************************************************************************/
+
+void ADC_monitor_begin(){
+    __adc_monitor_start(0);
+}
+
+/**
+ * @brief Stops scanning the monitored channels.
+ * 
+ * Returns the ADC to the on-demand configuration set up by ADC_begin().
+ * Events already in the queue are kept.
+ * 
+ * @return none
+ **************************************************************************/
+
+void ADC_monitor_end(){
+    AD1CON1bits.ADON = 0;
+    T3CONbits.TON = 0;
+#if __LIBADCREAD_ISR == 1
+    _AD1IE = 0;
+#endif
+    _AD1IF = 0;
+    AD1CON1bits.ASAM = 0;
+    AD1CON1bits.SSRC = 7;
     AD1CON1bits.DONE = 0;
-    return ADC1BUF0;
+    AD1CON2bits.CSCNA = 0;
+    AD1CON2bits.BUFM = 0;
+    AD1CON2bits.SMPI = 0;
+    AD1CSSL = 0;
+    adc_monitoring = 0;
+    AD1CON1bits.ADON = 1;
+}
+
+/**
+ * @param event Structure to be filled in with the oldest event.
+ * 
+ * @brief Takes the oldest threshold event from the queue.
+ * 
+ * @return 1 if an event was taken or 0 if the queue is empty.
+ **************************************************************************/
+
+int ADC_event(adc_event_t *event){
+    uint8_t tail = adc_event_tail;
+    if(tail == adc_event_head){
+        return 0;
+    }
+    *event = adc_event_queue[tail];
+    adc_event_tail = (tail + 1) & (_ADC_EVENT_QUEUE - 1);
+    return 1;
+}
+
+/**
+ * @brief Gives the number of events lost to a full queue.
+ * 
+ * @return The number of events dropped since the start of the program.
+ **************************************************************************/
+
+uint16_t ADC_event_overflow(){
+    return adc_event_lost;
+}
+
+/**
+ * @fn void ADC_update()
+ * @brief Checks the latest scan against the channel thresholds.
+ *
+ * This function must be called inside the _ADC1Interrupt() subroutine
+ * when __LIBADCREAD_ISR is set to 0. This allows the library to coexist
+ * with code that requires the use of the ADC interrupt.
+ * 
+ * @return none
+ * 
+ * @note If __LIBADCREAD_ISR is set to 1, then this function will not
+ * exist and will be replaced by a definition of _ADC1Interrupt().
+ **************************************************************************/
+
+#if __LIBADCREAD_ISR == 1
+void __attribute__ ((interrupt, no_auto_psv)) _ADC1Interrupt(){
+#else
+void ADC_update(){
+#endif
+    int i, j;
+    uint8_t channel;
+    uint16_t value;
+    volatile unsigned int *buffer = &ADC1BUF0;
+
+    // the half of a split buffer the ADC is not filling
+    if(AD1CON2bits.BUFM && !AD1CON2bits.BUFS){
+        buffer += 8;
+    }
+    // taken before the next conversion can overwrite them
+    for(i = 0; i < adc_scan_count; i++){
+        adc_scan_value[adc_scan_channel[i]] = buffer[i];
+    }
+
+    for(i = 0; i < adc_scan_count; i++){
+        channel = adc_scan_channel[i];
+        value = adc_scan_value[channel];
+        __adc_window_check(channel, value);
+        for(j = 0; j < _ADC_HOOKS; j++){
+            if(adc_hook[j]){
+                adc_hook[j](channel, value);
+            }
+        }
+    }
+    _AD1IF = 0;
 }
 
 #endif
\ No newline at end of file
@@ -13,7 +13,65 @@
 #ifndef __ADCREAD_TOOLBOX_H__
 #define __ADCREAD_TOOLBOX_H__
 
+/**
+ * @def ADC_EVENT_NORMAL
+ *
+ * @brief Event type for a channel returning inside its window.
+ *
+ * @def ADC_EVENT_LOW
+ *
+ * @brief Event type for a channel falling below its low threshold.
+ *
+ * @def ADC_EVENT_HIGH
+ *
+ * @brief Event type for a channel rising above its high threshold.
+ **************************************************************************/
+#define ADC_EVENT_NORMAL 0
+#define ADC_EVENT_LOW 1
+#define ADC_EVENT_HIGH 2
+
+/**
+ * @brief Threshold crossing event.
+ *
+ * Filled in by ADC_event() whenever a monitored channel leaves or returns
+ * to its window.
+ **************************************************************************/
+typedef struct {
+    uint8_t channel;    ///< Analog pin number of the channel.
+    uint8_t type;       ///< One of the ADC_EVENT_* values.
+    uint16_t value;     ///< Reading that caused the event.
+} adc_event_t;
+
+/**
+ * @brief Function called for every scanned sample.
+ *
+ * Functions of this type can be attached with ADC_attach() to receive
+ * every value read during the monitoring mode. These are called from
+ * inside the ADC interrupt and must return quickly.
+ **************************************************************************/
+typedef void (*adc_hook_t)(uint8_t channel, uint16_t value);
+
+extern const uint32_t adc_sample_rate;
+extern const uint32_t adc_monitor_rate;
+
 void ADC_begin();
 uint16_t analogRead(unsigned short pin);
+int ADC_start(unsigned short pin);
+int ADC_service();
+
+int ADC_monitor(uint8_t channel, uint16_t low, uint16_t high, uint16_t hysteresis);
+void ADC_monitor_begin();
+void ADC_monitor_end();
+int ADC_scan(uint8_t channel);
+int ADC_attach(adc_hook_t hook);
+void ADC_detach(adc_hook_t hook);
+int ADC_event(adc_event_t *event);
+uint16_t ADC_event_overflow();
+
+#if __LIBADCREAD_ISR == 1
+void __attribute__ ((interrupt, no_auto_psv)) _ADC1Interrupt(void);
+#else
+void ADC_update(void);
+#endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,314 @@
+/**
+ * @file  asset.c
+ * @brief This file contains function wrappers for EEPROM asset images
+ * @author Jaime Bronozo
+ *
+ * This is a library for fetching text tables, lookup tables and other
+ * assets from an image stored in EEPROM. The image starts with an index
+ * table giving the address and size of every asset by its number, which
+ * asset_begin() loads into RAM with a single read. After that, fetching
+ * a whole asset or part of it costs a single sequential read with one
+ * addressing preamble.
+ *
+ * Larger assets are streamed through two buffers of _ASSET_BLOCK bytes.
+ * While the application works on one buffer, the next block is read into
+ * the other one by the interrupt driven I2C library, so the bus and the
+ * CPU work at the same time. Reads of consecutive blocks still waiting in
+ * the queue are merged by i2c_async.c into one sequential read.
+ *
+ * The image is laid out as follows, with words in little endian as on
+ * the PIC24. The tool host/asset_pack.c builds it from a list of files.
+ *
+ * Offset | Size | Content
+ * ------ | ---- | -------
+ * 0 | 2 | #ASSET_MAGIC
+ * 2 | 2 | number of assets
+ * 4 | 4 per asset | #asset_entry_t of each asset
+ * after the index | 2 | CRC-16 of all the above, high byte first
+ *
+ * @date December 14, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBEEPROM_I2C_SETTINGS
+#define __LIBASSET_SETTINGS
+
+#include "toolbox_settings.h"
+#include "eeprom.h"
+#include "i2c_async.h"
+#include "asset.h"
+
+#if __LIBASSET_DISABLE != 1
+
+#if __LIBEEPROM_I2C_DISABLE == 1 || __LIBI2C_ASYNC_DISABLE == 1
+#error "asset.c requires the eeprom and i2c_async libraries to be enabled"
+#endif
+/// @endcond
+
+/**
+ * @brief Index table of the image as loaded by asset_begin().
+ *
+ * The extra entry holds the CRC when the image has _ASSET_INDEX assets.
+ **************************************************************************/
+typedef struct {
+    uint16_t magic;
+    uint16_t count;
+    asset_entry_t entry[_ASSET_INDEX + 1];
+} asset_index_t;
+
+asset_index_t asset_index;
+uint16_t asset_total = 0;
+
+void __asset_fetch(asset_stream_t *stream, uint8_t b){
+    uint16_t chunk = stream->left;
+
+    if(chunk > _ASSET_BLOCK){
+        chunk = _ASSET_BLOCK;
+    }
+    stream->size[b] = chunk;
+    if(!chunk){
+        return;
+    }
+
+    i2c_eeprom_read(&stream->txn[b], stream->buffer[b], chunk,
+            stream->address, _ASSET_DEV);
+    stream->txn[b].done = 0;
+    i2c_submit(&stream->txn[b]);
+    stream->address += chunk;
+    stream->left -= chunk;
+}
+
+/**
+ * @brief Loads the index table of the asset image.
+ *
+ * Reads the header and the index in a single sequential read and checks
+ * them against their CRC. Must be called after EEPROM_begin() and before
+ * any other function of this library.
+ *
+ * @return The number of assets, or -1 if the EEPROM cannot be read or
+ * holds no valid image with at most _ASSET_INDEX assets.
+ **************************************************************************/
+
+int asset_begin(){
+    asset_index_t *index = &asset_index;
+    uint8_t *check;
+    uint16_t size;
+
+    asset_total = 0;
+    if(EEPROM_read_block((char *) index, sizeof(asset_index_t),
+            _ASSET_ADDRESS, _ASSET_DEV) < 0){
+        return -1;
+    }
+    if(index->magic != ASSET_MAGIC || index->count > _ASSET_INDEX){
+        return -1;
+    }
+
+    size = 4 + index->count * sizeof(asset_entry_t);
+    check = (uint8_t *) index + size;
+    if(EEPROM_crc((char *) index, size) != ((check[0] << 8) | check[1])){
+        return -1;
+    }
+    asset_total = index->count;
+    return asset_total;
+}
+
+/**
+ * @brief Gives the number of assets in the image.
+ *
+ * @return The number of assets, 0 if asset_begin() failed.
+ **************************************************************************/
+
+int asset_count(){
+    return asset_total;
+}
+
+/**
+ * @param id Number of the asset.
+ *
+ * @brief Gives the size of an asset.
+ *
+ * @return The size in bytes or -1 if there is no such asset.
+ **************************************************************************/
+
+int32_t asset_size(uint16_t id){
+    if(id >= asset_total){
+        return -1;
+    }
+    return asset_index.entry[id].size;
+}
+
+/**
+ * @param id Number of the asset.
+ * @param buf Buffer for the bytes read.
+ * @param offset Offset of the first byte in the asset.
+ * @param size Number of bytes to read.
+ *
+ * @brief Reads part of an asset.
+ *
+ * The address comes from the index in RAM so this is a single sequential
+ * read. Reads stop at the end of the asset.
+ *
+ * @return The number of bytes read or -1 on failure or if there is no
+ * such asset.
+ **************************************************************************/
+
+int asset_read(uint16_t id, void *buf, uint16_t offset, int size){
+    asset_entry_t *entry = &asset_index.entry[id];
+
+    if(id >= asset_total || offset > entry->size){
+        return -1;
+    }
+    if(size > entry->size - offset){
+        size = entry->size - offset;
+    }
+    if(size <= 0){
+        return 0;
+    }
+    return EEPROM_read_block(buf, size, entry->address + offset, _ASSET_DEV);
+}
+
+/**
+ * @param id Number of the asset.
+ * @param buf Buffer for the text.
+ * @param size Size of the buffer, including the terminating null.
+ *
+ * @brief Reads a text asset as a string.
+ *
+ * Meant for tables of LCD text stored one string per asset. Unlike
+ * EEPROM_read_delim(), the length is known from the index so the text is
+ * read in one go. The string is cut to fit the buffer.
+ *
+ * @return The length of the string or -1 on failure.
+ **************************************************************************/
+
+int asset_text(uint16_t id, char *buf, int size){
+    int count;
+
+    if(size < 1){
+        return -1;
+    }
+    count = asset_read(id, buf, 0, size - 1);
+    if(count < 0){
+        return -1;
+    }
+    // images may store the terminating null with the text
+    while(count > 0 && buf[count - 1] == 0){
+        count--;
+    }
+    buf[count] = 0;
+    return count;
+}
+
+/**
+ * @param stream Stream to be set up.
+ * @param id Number of the asset.
+ *
+ * @brief Starts streaming an asset.
+ *
+ * Queues the reads of the first two blocks and returns without waiting
+ * for them.
+ *
+ * @return 0 on success or -1 if there is no such asset.
+ **************************************************************************/
+
+int asset_open(asset_stream_t *stream, uint16_t id){
+    if(id >= asset_total){
+        return -1;
+    }
+
+    stream->address = asset_index.entry[id].address;
+    stream->left = asset_index.entry[id].size;
+    stream->current = 0;
+    stream->started = 0;
+    stream->position = 0;
+    stream->error = 0;
+    stream->txn[0].status = I2C_IDLE;
+    stream->txn[1].status = I2C_IDLE;
+    __asset_fetch(stream, 0);
+    __asset_fetch(stream, 1);
+    return 0;
+}
+
+/**
+ * @param stream Stream to read from.
+ * @param block Set to the buffer holding the next block.
+ *
+ * @brief Gives the next block of an asset.
+ *
+ * The buffer given by the previous call is handed back to the library,
+ * which queues the read of the block after the next one into it. Then
+ * this waits for the next block, which is normally already read while the
+ * application was working on the previous one. The buffer stays valid
+ * until the next call to asset_next(), asset_getc() or asset_close().
+ *
+ * @return The number of bytes in the block, 0 at the end of the asset or
+ * -1 on failure, with the reason in the *error* field of the stream.
+ **************************************************************************/
+
+int asset_next(asset_stream_t *stream, char **block){
+    uint8_t b;
+
+    if(stream->started){
+        __asset_fetch(stream, stream->current);
+        stream->current ^= 1;
+    }
+    stream->started = 1;
+    stream->position = 0;
+
+    b = stream->current;
+    if(!stream->size[b]){
+        return 0;
+    }
+    if(i2c_wait(&stream->txn[b]) < 0){
+        stream->error = stream->txn[b].error;
+        stream->size[b] = 0;
+        return -1;
+    }
+    *block = stream->buffer[b];
+    return stream->size[b];
+}
+
+/**
+ * @param stream Stream to read from.
+ *
+ * @brief Reads a single byte of an asset.
+ *
+ * @return The byte read, or -1 at the end of the asset or on failure.
+ **************************************************************************/
+
+int asset_getc(asset_stream_t *stream){
+    char *block;
+
+    if(!stream->started || stream->position >= stream->size[stream->current]){
+        if(asset_next(stream, &block) <= 0){
+            return -1;
+        }
+    }
+    return (uint8_t) stream->buffer[stream->current][stream->position++];
+}
+
+/**
+ * @param stream Stream to be closed.
+ *
+ * @brief Stops streaming an asset.
+ *
+ * Waits for the reads still queued into the buffers of the stream.
+ *
+ * @return none
+ **************************************************************************/
+
+void asset_close(asset_stream_t *stream){
+    int b;
+
+    for(b = 0; b < 2; b++){
+        if(stream->txn[b].status == I2C_PENDING
+                || stream->txn[b].status == I2C_BUSY){
+            i2c_wait(&stream->txn[b]);
+        }
+    }
+    stream->left = 0;
+    stream->size[0] = 0;
+    stream->size[1] = 0;
+}
+
+#endif
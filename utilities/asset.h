@@ -0,0 +1,63 @@
+/**
+ * @file  asset.h
+ * @brief This file contains function wrappers for EEPROM asset images
+ * @author Jaime Bronozo
+ *
+ * This is a header file for asset.c which must be included to any source
+ * files that require text tables, lookup tables or other assets stored
+ * in an EEPROM image. This library is dynamically included in the main
+ * header PIC24_toolbox.h
+ *
+ * @date December 14, 2018
+ **************************************************************************/
+
+#ifndef __ASSET_TOOLBOX_H__
+#define __ASSET_TOOLBOX_H__
+
+/**
+ * @def ASSET_MAGIC
+ *
+ * @brief First word of an asset image.
+ **************************************************************************/
+#define ASSET_MAGIC 0xa55e
+
+/**
+ * @brief Entry of the index table of an asset image.
+ **************************************************************************/
+typedef struct {
+    uint16_t address;   ///< Address of the asset in the chip.
+    uint16_t size;      ///< Size of the asset in bytes.
+} asset_entry_t;
+
+/**
+ * @brief Stream over a single asset.
+ *
+ * Set up with asset_open(). While the application works on one buffer,
+ * the next block of the asset is read into the other one in the
+ * background. The stream must be closed with asset_close() before it is
+ * opened again or goes out of scope. The fields are maintained by the
+ * library.
+ **************************************************************************/
+typedef struct {
+    uint16_t address;   ///< Address of the next block to read.
+    uint16_t left;      ///< Bytes of the asset not yet requested.
+    uint16_t size[2];   ///< Bytes in each buffer, 0 past the end.
+    uint16_t position;  ///< Next byte of the current buffer for asset_getc().
+    uint8_t current;    ///< Buffer handed to the application.
+    uint8_t started;
+    uint32_t error;     ///< Error of a failed read, as in EEPROM_error().
+    i2c_txn_t txn[2];
+    char buffer[2][_ASSET_BLOCK];
+} asset_stream_t;
+
+int asset_begin();
+int asset_count();
+int32_t asset_size(uint16_t id);
+int asset_read(uint16_t id, void *buf, uint16_t offset, int size);
+int asset_text(uint16_t id, char *buf, int size);
+int asset_open(asset_stream_t *stream, uint16_t id);
+int asset_next(asset_stream_t *stream, char **block);
+int asset_getc(asset_stream_t *stream);
+void asset_close(asset_stream_t *stream);
+
+#endif
@@ -0,0 +1,259 @@
+/**
+ * @file  config.c
+ * @brief This file contains function wrappers for persistent settings
+ * @author Jaime Bronozo
+ *
+ * This is a library for keeping the settings of an application in EEPROM.
+ * The settings are declared once in _CONFIG_SCHEMA in toolbox_settings.h,
+ * which generates the config_t structure and the code setting the
+ * defaults at compile time. config_load() reads the stored settings into
+ * the global #config with one sequential read per copy, and config_save()
+ * writes back only the pages where bytes changed.
+ *
+ * The settings are stored after a small header holding the schema version,
+ * the size and a sequence number, and are followed by a CRC-16. Since
+ * fields are only ever appended to the schema, settings stored by an older
+ * version keep their place, and the fields added later are set to their
+ * defaults on load.
+ *
+ * Two copies are kept in pages of their own, like the slots of recstore.c.
+ * Every save goes to the copy not holding the latest settings with the
+ * next sequence number, and config_load() takes the newest copy passing
+ * its CRC. A save cut short by a power loss only damages the older copy,
+ * so the settings of the previous save are loaded on the next start.
+ *
+ * @date December 12, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBEEPROM_I2C_SETTINGS
+#define __LIBCONFIG_SETTINGS
+
+#include <stddef.h>
+#include "toolbox_settings.h"
+#include "eeprom.h"
+#include "config.h"
+
+#if __LIBCONFIG_DISABLE != 1
+
+#if __LIBEEPROM_I2C_DISABLE == 1
+#error "config.c requires the eeprom library to be enabled"
+#endif
+
+#define __CONFIG_MAGIC 0xc0f6
+#define __CONFIG_HEADER 8
+#define __CONFIG_TOTAL (__CONFIG_HEADER + sizeof(config_t) + 2)
+
+// each copy starts a page so a cut write cannot reach the other
+#define __CONFIG_STRIDE ((__CONFIG_TOTAL + _EEPROM_PAGE_SIZE - 1) \
+        & ~(_EEPROM_PAGE_SIZE - 1UL))
+
+#if _CONFIG_ADDRESS % _EEPROM_PAGE_SIZE != 0
+#error "_CONFIG_ADDRESS must be aligned to _EEPROM_PAGE_SIZE"
+#endif
+
+// sets the fields added after version *from* or past the stored *size*
+#define __CONFIG_MIGRATE(version, type, name, value) \
+    if((version) > from || offsetof(config_t, name) + sizeof(type) > size){ \
+        config.name = (value); \
+    }
+
+// fails to compile if two copies of the settings do not fit in _CONFIG_SIZE
+typedef char __config_size_check[(2 * __CONFIG_STRIDE <= _CONFIG_SIZE) ? 1 : -1];
+/// @endcond
+
+/**
+ * @brief Settings as stored in the EEPROM.
+ *
+ * Internal structure holding the header, the settings and the CRC that
+ * follows the *size* bytes of settings. Of two valid copies, the one with
+ * the later *sequence* modulo 2^16 holds the latest settings.
+ **************************************************************************/
+typedef struct {
+    uint16_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint16_t sequence;
+    uint8_t data[sizeof(config_t) + 2];
+} config_image_t;
+
+/**
+ * @brief Current settings.
+ *
+ * Filled in by config_load(). Changes are kept in RAM until config_save()
+ * is called.
+ **************************************************************************/
+config_t config;
+
+config_image_t config_stored[2];
+uint8_t config_known[2] = {0, 0};
+int8_t config_current = -1;
+uint16_t config_sequence = 0;
+
+void __config_migrate(uint16_t from, uint16_t size){
+    _CONFIG_SCHEMA(__CONFIG_MIGRATE)
+}
+
+uint16_t __config_address(uint8_t copy){
+    return _CONFIG_ADDRESS + copy * __CONFIG_STRIDE;
+}
+
+int __config_valid(config_image_t *image){
+    uint16_t size = image->size, check;
+
+    if(image->magic != __CONFIG_MAGIC || size > sizeof(config_t)){
+        return 0;
+    }
+    check = (image->data[size] << 8) | image->data[size + 1];
+    return EEPROM_crc((char *) image, __CONFIG_HEADER + size) == check;
+}
+
+/**
+ * @brief Sets every field to its default.
+ *
+ * Only the settings in RAM are changed.
+ *
+ * @return none
+ **************************************************************************/
+
+void config_reset(){
+    __config_migrate(0, 0);
+}
+
+/**
+ * @brief Loads the settings from the EEPROM.
+ *
+ * Reads the header, the settings and the CRC of each copy in a single
+ * sequential read and takes the newest copy passing its CRC. If neither
+ * is valid, or the newest comes from a newer _CONFIG_VERSION, every field
+ * is set to its default.
+ *
+ * @return #CONFIG_LOADED, #CONFIG_MIGRATED or #CONFIG_DEFAULTS, or -1 if
+ * the EEPROM cannot be read, in which case the defaults are used.
+ **************************************************************************/
+
+int config_load(){
+    config_image_t *image;
+    uint8_t valid[2];
+    int i;
+
+    config_current = -1;
+    for(i = 0; i < 2; i++){
+        config_known[i] = 0;
+        if(EEPROM_read_block((char *) &config_stored[i], __CONFIG_TOTAL,
+                __config_address(i), _CONFIG_DEV) < 0){
+            config_reset();
+            return -1;
+        }
+        config_known[i] = 1;
+        valid[i] = __config_valid(&config_stored[i]);
+    }
+
+    if(valid[0] && valid[1]){
+        config_current = (int16_t) (config_stored[1].sequence
+                - config_stored[0].sequence) > 0;
+    }
+    else if(valid[0] || valid[1]){
+        config_current = valid[1];
+    }
+    else{
+        config_reset();
+        return CONFIG_DEFAULTS;
+    }
+
+    image = &config_stored[config_current];
+    config_sequence = image->sequence;
+    if(image->version > _CONFIG_VERSION){
+        config_reset();
+        return CONFIG_DEFAULTS;
+    }
+
+    for(i = 0; i < image->size; i++){
+        ((uint8_t *) &config)[i] = image->data[i];
+    }
+    __config_migrate(image->version, image->size);
+    return image->version < _CONFIG_VERSION ? CONFIG_MIGRATED : CONFIG_LOADED;
+}
+
+/**
+ * @brief Writes the changed settings to the EEPROM.
+ *
+ * Writes the settings to the copy that does not hold the latest ones,
+ * comparing them with what config_load() or the save before the previous
+ * one left in it, and sends a single page write for each page holding
+ * changed bytes, covering only the changed range of that page. Nothing is
+ * written if the settings are the same as the latest copy.
+ *
+ * @return The number of bytes written or -1 on failure, in which case
+ * the latest copy is left as it was.
+ **************************************************************************/
+
+int config_save(){
+    config_image_t image, *latest;
+    uint8_t *now = (uint8_t *) &image, *was;
+    uint8_t copy = config_current == 0;
+    uint16_t check, i, j, end;
+    int first, last, count = 0;
+
+    if(config_current >= 0){
+        latest = &config_stored[config_current];
+        for(i = 0; i < sizeof(config_t); i++){
+            if(latest->data[i] != ((uint8_t *) &config)[i]){
+                break;
+            }
+        }
+        if(i == sizeof(config_t) && latest->version == _CONFIG_VERSION
+                && latest->size == sizeof(config_t)){
+            return 0;
+        }
+    }
+
+    image.magic = __CONFIG_MAGIC;
+    image.version = _CONFIG_VERSION;
+    image.size = sizeof(config_t);
+    image.sequence = config_sequence + 1;
+    for(i = 0; i < sizeof(config_t); i++){
+        image.data[i] = ((uint8_t *) &config)[i];
+    }
+    check = EEPROM_crc((char *) &image, __CONFIG_HEADER + sizeof(config_t));
+    image.data[sizeof(config_t)] = check >> 8;
+    image.data[sizeof(config_t) + 1] = check & 0xff;
+
+    was = (uint8_t *) &config_stored[copy];
+    for(i = 0; i < __CONFIG_TOTAL; i = end){
+        end = i + _EEPROM_PAGE_SIZE - (i & (_EEPROM_PAGE_SIZE - 1));
+        if(end > __CONFIG_TOTAL){
+            end = __CONFIG_TOTAL;
+        }
+
+        first = last = -1;
+        for(j = i; j < end; j++){
+            if(!config_known[copy] || now[j] != was[j]){
+                if(first < 0){
+                    first = j;
+                }
+                last = j;
+            }
+        }
+        if(first < 0){
+            continue;
+        }
+
+        if(EEPROM_write_page((char *) now + first, last - first + 1,
+                __config_address(copy) + first, _CONFIG_DEV) < 0){
+            config_known[copy] = 0;
+            return -1;
+        }
+        count += last - first + 1;
+        for(j = first; j <= last; j++){
+            was[j] = now[j];
+        }
+    }
+
+    config_known[copy] = 1;
+    config_current = copy;
+    config_sequence = image.sequence;
+    return count;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/**
+ * @file  config.h
+ * @brief This file contains function wrappers for persistent settings
+ * @author Jaime Bronozo
+ *
+ * This is a header file for config.c which must be included to any
+ * source files that require the settings kept in EEPROM. This library is
+ * dynamically included in the main header PIC24_toolbox.h
+ *
+ * @date December 12, 2018
+ **************************************************************************/
+
+#ifndef __CONFIG_TOOLBOX_H__
+#define __CONFIG_TOOLBOX_H__
+
+/**
+ * @def CONFIG_LOADED
+ *
+ * @brief The stored settings were loaded as they are.
+ *
+ * @def CONFIG_MIGRATED
+ *
+ * @brief The stored settings were from an older _CONFIG_VERSION and the
+ * fields added since were set to their defaults.
+ *
+ * @def CONFIG_DEFAULTS
+ *
+ * @brief No valid settings were stored and every field was set to its
+ * default.
+ **************************************************************************/
+#define CONFIG_LOADED 0
+#define CONFIG_MIGRATED 1
+#define CONFIG_DEFAULTS 2
+
+/// @cond
+#define __CONFIG_MEMBER(version, type, name, value) type name;
+/// @endcond
+
+/**
+ * @brief Settings declared by _CONFIG_SCHEMA in toolbox_settings.h.
+ **************************************************************************/
+typedef struct {
+    _CONFIG_SCHEMA(__CONFIG_MEMBER)
+} config_t;
+
+extern config_t config;
+
+int config_load();
+int config_save();
+void config_reset();
+
+#endif
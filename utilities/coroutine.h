@@ -0,0 +1,154 @@
+/**
+ * @file  coroutine.h
+ * @brief This file contains macros for stackless coroutines
+ * @author Jaime Bronozo
+ *
+ * This header lets a driver operation that would wait in delay_us() or a
+ * polling loop be written as the same sequence of steps, but returning to
+ * the caller at each wait instead. The point to resume from is kept in a
+ * tb_thread_t of 2 bytes, the line number of the wait, and the function
+ * jumps back to it through a switch on the next call. There is no stack
+ * or heap per coroutine.
+ *
+ * A coroutine is a function returning int whose body is put between
+ * TB_BEGIN() and TB_END(). It returns #TB_WAITING while it is waiting and
+ * #TB_DONE once it reaches the end, after which the next call starts it
+ * over. Since the function really returns, local variables do not keep
+ * their values across a wait and anything needed afterwards must be kept
+ * in a structure passed by the caller alongside the tb_thread_t. A switch
+ * statement must not be used around a wait, and two waits must not be on
+ * the same line.
+ *
+ * ```C
+ * typedef struct {
+ *     tb_thread_t thread;
+ *     uint8_t i;
+ *     uint32_t until;
+ * } blink_t;
+ *
+ * int blink(blink_t *op){
+ *     TB_BEGIN(&op->thread);
+ *     for(op->i = 0; op->i < 3; op->i++){
+ *         led_on();
+ *         op->until = ticker_ms() + 100;
+ *         TB_AWAIT((int32_t) (ticker_ms() - op->until) >= 0);
+ *         led_off();
+ *         TB_YIELD();
+ *     }
+ *     TB_END();
+ * }
+ * ```
+ *
+ * A coroutine can wait for another one with TB_AWAIT(), since it is done
+ * when the other returns #TB_DONE. This header is included by
+ * toolbox_settings.h so the macros are available to every library.
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+#ifndef __COROUTINE_TOOLBOX_H__
+#define __COROUTINE_TOOLBOX_H__
+
+/**
+ * @def TB_WAITING
+ *
+ * @brief Returned by a coroutine that has not reached its end.
+ *
+ * @def TB_DONE
+ *
+ * @brief Returned by a coroutine that has reached its end.
+ **************************************************************************/
+#define TB_WAITING 0
+#define TB_DONE 1
+
+/**
+ * @brief State of a coroutine.
+ *
+ * Must be set up with TB_INIT() or zeroed before the first call.
+ **************************************************************************/
+typedef struct {
+    uint16_t line;      ///< Line to resume from, 0 at the start.
+} tb_thread_t;
+
+/**
+ * @def TB_INIT(t)
+ * @param t Pointer to the tb_thread_t of the coroutine.
+ *
+ * @brief Makes the next call of a coroutine start from the beginning.
+ *
+ * @def TB_BEGIN(t)
+ * @param t Pointer to the tb_thread_t of the coroutine.
+ *
+ * @brief Starts the body of a coroutine.
+ *
+ * @def TB_END()
+ *
+ * @brief Ends the body of a coroutine, returning #TB_DONE.
+ *
+ * @def TB_AWAIT(c)
+ * @param c Condition to wait for.
+ *
+ * @brief Returns #TB_WAITING until the condition is true.
+ *
+ * The condition is checked at once and again on every later call, so a
+ * condition that is already true does not return to the caller.
+ *
+ * @def TB_YIELD()
+ *
+ * @brief Returns #TB_WAITING once and continues on the next call.
+ *
+ * @def TB_EXIT()
+ *
+ * @brief Returns #TB_DONE before the end of the body.
+ **************************************************************************/
+#define TB_INIT(t) ((t)->line = 0)
+
+/// @cond
+// a fall through comment does not survive the expansion, the attribute does
+#if defined(__has_attribute)
+#if __has_attribute(fallthrough)
+#define __TB_FALLTHROUGH __attribute__((fallthrough))
+#endif
+#endif
+#ifndef __TB_FALLTHROUGH
+#define __TB_FALLTHROUGH
+#endif
+/// @endcond
+
+#define TB_BEGIN(t) { \
+    tb_thread_t *__tb_thread = (t); \
+    uint8_t __tb_yield = 0; \
+    (void) __tb_yield; \
+    switch(__tb_thread->line){ \
+    case 0:
+
+#define TB_END() } \
+    __tb_thread->line = 0; \
+    return TB_DONE; \
+}
+
+#define TB_AWAIT(c) do { \
+    __tb_thread->line = __LINE__; \
+    __TB_FALLTHROUGH; \
+    case __LINE__: \
+    if(!(c)){ \
+        return TB_WAITING; \
+    } \
+} while(0)
+
+#define TB_YIELD() do { \
+    __tb_yield = 1; \
+    __tb_thread->line = __LINE__; \
+    __TB_FALLTHROUGH; \
+    case __LINE__: \
+    if(__tb_yield){ \
+        return TB_WAITING; \
+    } \
+} while(0)
+
+#define TB_EXIT() do { \
+    __tb_thread->line = 0; \
+    return TB_DONE; \
+} while(0)
+
+#endif
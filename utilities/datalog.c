@@ -0,0 +1,348 @@
+/**
+ * @file  datalog.c
+ * @brief This file contains function wrappers for ADC data logging
+ * @author Jaime Bronozo
+ *
+ * This is a library for logging scanned analog samples to an I2C EEPROM
+ * without stalling the ADC. Samples are collected by the ADC interrupt
+ * into one of two page sized blocks while the other block is written to
+ * the EEPROM by datalog_service() from the main loop. Each block starts
+ * with a header holding its position in the log and the index of its
+ * first sample so the log can be read back with datalog_next().
+ *
+ * Only one scan in every adc_monitor_rate / _DATALOG_SPS is logged, so
+ * every channel is logged _DATALOG_SPS times a second. A block is written
+ * while the other fills, so the blocks must fill slower than the chip
+ * takes to write one, about 5ms for a 24LC256. With 64 byte blocks of 24
+ * samples this is _DATALOG_SPS times the number of channels up to about
+ * 4800 samples a second, past which samples are dropped.
+ *
+ * @note This library requires both the adcread and eeprom libraries.
+ *
+ * @date November 26, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBDATALOG_SETTINGS
+
+#include "toolbox_settings.h"
+#include "adcread.h"
+#include "eeprom.h"
+#include "datalog.h"
+
+#if __LIBDATALOG_DISABLE != 1
+
+#if __LIBADCREAD_DISABLE == 1 || __LIBEEPROM_I2C_DISABLE == 1
+#error "datalog.c requires the adcread and eeprom libraries to be enabled"
+#endif
+
+#if _DATALOG_START % _DATALOG_BLOCK_SIZE != 0
+#error "_DATALOG_START must be aligned to _DATALOG_BLOCK_SIZE"
+#endif
+
+#define __DATALOG_SAMPLES ((_DATALOG_BLOCK_SIZE - \
+        sizeof(datalog_header_t)) / sizeof(uint16_t))
+
+#if _DATALOG_SPS < 1
+#error "_DATALOG_SPS must be at least 1"
+#endif
+/// @endcond
+
+/**
+ * @brief A page sized block of samples.
+ *
+ * Internal structure written to the EEPROM as a single page.
+ **************************************************************************/
+typedef struct {
+    datalog_header_t header;
+    uint16_t samples[__DATALOG_SAMPLES];
+} datalog_block_t;
+
+datalog_block_t datalog_block[2];
+volatile uint8_t datalog_ready[2] = {0, 0};
+volatile uint8_t datalog_fill = 0;
+volatile uint16_t datalog_count = 0;
+volatile uint32_t datalog_samples = 0;
+volatile uint32_t datalog_lost = 0;
+volatile uint8_t datalog_running = 0;
+uint16_t datalog_decimate = 1;
+uint16_t datalog_phase = 0;
+uint8_t datalog_first = 0;
+
+uint8_t datalog_commit = 0;
+uint8_t datalog_stopped = 0;
+uint16_t datalog_mask = 0;
+uint16_t datalog_address = _DATALOG_START;
+uint16_t datalog_session = 0;
+uint16_t datalog_sequence = 0;
+
+int __datalog_read(void *buf, int size, uint16_t address){
+    return EEPROM_read_block(buf, size, address, _DATALOG_DEV);
+}
+
+/**
+ * @param channels Mask of the analog channels to log, with bit 0 for AN0.
+ *
+ * @brief Starts a new logging session.
+ *
+ * Starts writing at the beginning of the log region, replacing any
+ * previous session, and adds the channels to the ADC scan. The ADC must
+ * have been set up with ADC_begin() beforehand. This attaches
+ * datalog_sample() to the ADC scan and starts the monitoring mode.
+ *
+ * @return 0 on success or -1 if the EEPROM cannot be read.
+ **************************************************************************/
+
+int datalog_begin(uint16_t channels){
+    datalog_header_t previous;
+    int i;
+
+    if(!channels){
+        return -1;
+    }
+    if(__datalog_read(&previous, sizeof(previous), _DATALOG_START) < 0){
+        return -1;
+    }
+
+    // a new session number keeps blocks of older sessions out of reads
+    datalog_session = previous.session + 1;
+    if(datalog_session == 0xffff){
+        datalog_session = 0;
+    }
+    datalog_sequence = 0;
+    datalog_address = _DATALOG_START;
+    datalog_stopped = 0;
+
+    datalog_running = 0;
+    datalog_ready[0] = 0;
+    datalog_ready[1] = 0;
+    datalog_fill = 0;
+    datalog_commit = 0;
+    datalog_count = 0;
+    datalog_samples = 0;
+    datalog_lost = 0;
+    datalog_mask = channels;
+
+    // the first scan is logged, then one in every datalog_decimate
+    datalog_decimate = adc_monitor_rate / _DATALOG_SPS;
+    if(!datalog_decimate){
+        datalog_decimate = 1;
+    }
+    datalog_phase = datalog_decimate - 1;
+
+    for(i = 15; i >= 0; i--){
+        if(channels & (1 << i)){
+            ADC_scan(i);
+            datalog_first = i;
+        }
+    }
+    ADC_attach(datalog_sample);
+    datalog_running = 1;
+    ADC_monitor_begin();
+    return 0;
+}
+
+/**
+ * @brief Stops the logging session.
+ *
+ * Stops taking samples and writes every block that has not been written
+ * yet, including the partially filled one. This blocks until all the
+ * writes are done or one of them fails.
+ *
+ * @return 0 on success or -1 if a block could not be written.
+ **************************************************************************/
+
+int datalog_end(){
+    datalog_block_t *block;
+
+    datalog_running = 0;
+    if(datalog_count && !datalog_ready[datalog_fill]){
+        block = &datalog_block[datalog_fill];
+        block->header.count = datalog_count;
+        datalog_ready[datalog_fill] = 1;
+        datalog_fill ^= 1;
+        datalog_count = 0;
+    }
+
+    while(datalog_ready[datalog_commit]){
+        if(datalog_service() < 0){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes a completed block to the EEPROM.
+ *
+ * Must be called regularly from the main loop while logging. Returns
+ * immediately if no block is complete or if the EEPROM is still busy
+ * with the previous page write.
+ *
+ * @return 1 if a block was written, 0 if there was nothing to do or -1
+ * if the chip cannot be reached, the write failed or the log region is
+ * full.
+ **************************************************************************/
+
+int datalog_service(){
+    datalog_block_t *block = &datalog_block[datalog_commit];
+    int fval;
+
+    if(!datalog_ready[datalog_commit]){
+        return 0;
+    }
+    if((uint32_t) datalog_address + _DATALOG_BLOCK_SIZE > _DATALOG_END){
+        datalog_running = 0;
+        datalog_stopped = 1;
+        return -1;
+    }
+
+    fval = EEPROM_write_done(_DATALOG_DEV);
+    if(fval != 1){
+        return fval;
+    }
+
+    block->header.session = datalog_session;
+    block->header.sequence = datalog_sequence;
+    block->header.channels = datalog_mask;
+    if(EEPROM_write_page((char *) block, _DATALOG_BLOCK_SIZE,
+            datalog_address, _DATALOG_DEV) < 0){
+        return -1;
+    }
+
+    datalog_address += _DATALOG_BLOCK_SIZE;
+    datalog_sequence++;
+    datalog_ready[datalog_commit] = 0;
+    datalog_commit ^= 1;
+    return 1;
+}
+
+/**
+ * @param channel Analog pin number the sample came from.
+ * @param value Sample value.
+ *
+ * @brief Adds a sample to the current block.
+ *
+ * This is attached to the ADC scan by datalog_begin() and is called from
+ * inside the ADC interrupt. It can also be attached through a different
+ * function with the signature of #adc_hook_t. Only one scan in every
+ * adc_monitor_rate / _DATALOG_SPS is kept. Samples kept while both blocks
+ * are waiting to be written are dropped and counted.
+ *
+ * @return none
+ **************************************************************************/
+
+void datalog_sample(uint8_t channel, uint16_t value){
+    datalog_block_t *block;
+
+    if(!datalog_running || !(datalog_mask & (1 << channel))){
+        return;
+    }
+    // a scan starts with the lowest logged channel
+    if(channel == datalog_first && ++datalog_phase >= datalog_decimate){
+        datalog_phase = 0;
+    }
+    if(datalog_phase){
+        return;
+    }
+    if(datalog_ready[datalog_fill]){
+        datalog_samples++;
+        datalog_lost++;
+        return;
+    }
+
+    block = &datalog_block[datalog_fill];
+    if(datalog_count == 0){
+        block->header.timestamp = datalog_samples;
+        block->header.dropped = datalog_lost;
+    }
+    block->samples[datalog_count++] = value;
+    datalog_samples++;
+
+    if(datalog_count == __DATALOG_SAMPLES){
+        block->header.count = datalog_count;
+        datalog_ready[datalog_fill] = 1;
+        datalog_fill ^= 1;
+        datalog_count = 0;
+    }
+}
+
+/**
+ * @brief Gives the number of dropped samples.
+ *
+ * @return The number of samples dropped in the current session because
+ * the EEPROM could not keep up with the ADC.
+ **************************************************************************/
+
+uint32_t datalog_dropped(){
+    return datalog_lost;
+}
+
+/**
+ * @brief Checks if the log region ran out of space.
+ *
+ * @return 1 if logging was stopped because the region is full or 0 if
+ * not.
+ **************************************************************************/
+
+int datalog_full(){
+    return datalog_stopped;
+}
+
+/**
+ * @param iter Iterator to be set up.
+ *
+ * @brief Starts reading back the latest session.
+ *
+ * @return 0 on success or -1 if the EEPROM cannot be read.
+ **************************************************************************/
+
+int datalog_rewind(datalog_iter_t *iter){
+    datalog_header_t header;
+    if(__datalog_read(&header, sizeof(header), _DATALOG_START) < 0){
+        return -1;
+    }
+    iter->address = _DATALOG_START;
+    iter->session = header.session;
+    iter->sequence = 0;
+    return 0;
+}
+
+/**
+ * @param iter Iterator set up by datalog_rewind().
+ * @param header Structure to be filled in with the block header.
+ * @param samples Buffer to receive the samples of the block.
+ * @param size Maximum number of samples to store in *samples*.
+ *
+ * @brief Reads the next block of the session.
+ *
+ * @return The number of samples stored, 0 at the end of the session or -1
+ * if the EEPROM cannot be read.
+ **************************************************************************/
+
+int datalog_next(datalog_iter_t *iter, datalog_header_t *header, uint16_t *samples, int size){
+    if((uint32_t) iter->address + _DATALOG_BLOCK_SIZE > _DATALOG_END){
+        return 0;
+    }
+    if(__datalog_read(header, sizeof(*header), iter->address) < 0){
+        return -1;
+    }
+    if(header->session != iter->session || header->sequence != iter->sequence
+            || header->count == 0 || header->count > __DATALOG_SAMPLES){
+        return 0;
+    }
+
+    if(size > header->count){
+        size = header->count;
+    }
+    if(__datalog_read(samples, size * sizeof(uint16_t),
+            iter->address + sizeof(*header)) < 0){
+        return -1;
+    }
+
+    iter->address += _DATALOG_BLOCK_SIZE;
+    iter->sequence++;
+    return size;
+}
+
+#endif
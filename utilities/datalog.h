@@ -0,0 +1,54 @@
+/**
+ * @file  datalog.h
+ * @brief This file contains function wrappers for ADC data logging
+ * @author Jaime Bronozo
+ *
+ * This is a header file for datalog.c which must be included to any
+ * source files that require logging of analog samples to EEPROM. This
+ * library is dynamically included in the main header PIC24_toolbox.h
+ *
+ * @date November 26, 2018
+ **************************************************************************/
+
+#ifndef __DATALOG_TOOLBOX_H__
+#define __DATALOG_TOOLBOX_H__
+
+/**
+ * @brief Header written at the start of every logged block.
+ *
+ * The samples following the header are interleaved in increasing channel
+ * order of the channels set in *channels*. Since samples can be dropped
+ * when both buffers are full, the channel of the first sample of a block
+ * is found from *timestamp* modulo the number of logged channels.
+ **************************************************************************/
+typedef struct {
+    uint16_t session;   ///< Incremented by every call to datalog_begin().
+    uint16_t sequence;  ///< Block number within the session.
+    uint16_t channels;  ///< Mask of the logged channels.
+    uint16_t count;     ///< Number of samples in the block.
+    uint32_t timestamp; ///< Sample index of the first sample in the block.
+    uint32_t dropped;   ///< Samples dropped before this block.
+} datalog_header_t;
+
+/**
+ * @brief Position of a read back in progress.
+ *
+ * Set up with datalog_rewind() and advanced by datalog_next().
+ **************************************************************************/
+typedef struct {
+    uint16_t address;
+    uint16_t session;
+    uint16_t sequence;
+} datalog_iter_t;
+
+int datalog_begin(uint16_t channels);
+int datalog_end();
+int datalog_service();
+void datalog_sample(uint8_t channel, uint16_t value);
+uint32_t datalog_dropped();
+int datalog_full();
+
+int datalog_rewind(datalog_iter_t *iter);
+int datalog_next(datalog_iter_t *iter, datalog_header_t *header, uint16_t *samples, int size);
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * @file  delay.c
+ * @brief This file contains function wrappers for timer based delays
+ * @author Jaime Bronozo
+ *
+ * This is a library for delays measured against a free running 32-bit
+ * timer counting instruction cycles. A loop of **__delay32()** counts its
+ * own cycles, so an interrupt taken in the middle adds its whole length
+ * to the delay. delay_until() instead waits for the timer to reach a
+ * deadline, so interrupts only make it late by the time of the one that
+ * is running when the deadline passes. Deadlines are set from the time
+ * taken before any other work, so that work is part of the delay.
+ *
+ * ```C
+ * uint32_t start = delay_now();
+ * lcd_command(LCD_CLEAR);
+ * prepare_next_line();
+ * delay_until(start + DELAY_MS(2));
+ * ```
+ *
+ * The timer also measures the cycles of a call to delay_us() that
+ * **__delay32()** does not count, which is entered as _DELAY_OVERHEAD in
+ * toolbox_settings.h, and the same for a delay_us() with a runtime
+ * argument, entered as _DELAY_RUN_OVERHEAD.
+ *
+ * This file also holds **__delay_run()**, which the delay macros of
+ * toolbox_settings.h call for an argument that is not a constant. It is
+ * built even with the library disabled since those macros are used by the
+ * other libraries.
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBDELAY_SETTINGS
+
+#include "toolbox_settings.h"
+#include "delay.h"
+
+/**
+ * @param d Time in the unit of the delay macro used.
+ * @param per_unit Instruction cycles per unit, rounded up.
+ * @param limit Largest *d* whose cycles fit in 32 bits.
+ *
+ * @brief Stalls execution for a time only known at runtime.
+ *
+ * Called by delay_cycles() and the other delay macros when their argument
+ * is not a constant. The cycle count is worked out once with a 32-bit
+ * multiplication taking the same time for any *d*, so the cycles of the
+ * call and of the arithmetic are a fixed _DELAY_RUN_OVERHEAD taken off
+ * the delay.
+ *
+ * @return none
+ **************************************************************************/
+
+void __delay_run(unsigned long d, unsigned long per_unit, unsigned long limit){
+    unsigned long cycles = d > limit ? 0xffffffffUL : d * per_unit;
+
+    __delay32(cycles > _DELAY_MIN + _DELAY_RUN_OVERHEAD ?
+            cycles - _DELAY_RUN_OVERHEAD : _DELAY_MIN);
+}
+
+#if __LIBDELAY_DISABLE != 1
+
+#define __DELAY_PASTE(x, y, z) x##y##z
+#define __DELAY_ACCESS(x, y, z) __DELAY_PASTE(x, y, z)
+#define _DELAY_CON __DELAY_ACCESS(T, _DELAY_TIMER, CONbits)
+#define _DELAY_CON_MSW __DELAY_ACCESS(T, _DELAY_TIMER_MSW, CONbits)
+#define _DELAY_TMR __DELAY_ACCESS(TMR, _DELAY_TIMER, )
+#define _DELAY_TMR_MSW __DELAY_ACCESS(TMR, _DELAY_TIMER_MSW, )
+#define _DELAY_HLD __DELAY_ACCESS(TMR, _DELAY_TIMER_MSW, HLD)
+#define _DELAY_PR __DELAY_ACCESS(PR, _DELAY_TIMER, )
+#define _DELAY_PR_MSW __DELAY_ACCESS(PR, _DELAY_TIMER_MSW, )
+#define _DELAY_IE __DELAY_ACCESS(_T, _DELAY_TIMER_MSW, IE)
+
+#define _DELAY_TEST_US 100
+/// @endcond
+
+/**
+ * @brief Starts the timer used by the library.
+ *
+ * Joins the timers _DELAY_TIMER and _DELAY_TIMER_MSW into a 32-bit timer
+ * counting every instruction cycle and wrapping around after 2^32 of
+ * them. The timers must not be used by anything else afterwards.
+ *
+ * @return none
+ **************************************************************************/
+
+void delay_begin(){
+    _DELAY_CON.TON = 0;
+    _DELAY_CON_MSW.TON = 0;
+    _DELAY_CON.TCS = 0;
+    _DELAY_CON.TGATE = 0;
+    _DELAY_CON.TCKPS = 0;
+    _DELAY_CON.T32 = 1;
+    _DELAY_IE = 0;
+    _DELAY_TMR_MSW = 0;
+    _DELAY_TMR = 0;
+    _DELAY_PR_MSW = 0xffff;
+    _DELAY_PR = 0xffff;
+    _DELAY_CON.TON = 1;
+}
+
+/**
+ * @brief Gives the time in instruction cycles.
+ *
+ * Reading the low word latches the high word, so the two halves always
+ * belong together.
+ *
+ * @return Instruction cycles since delay_begin(), modulo 2^32.
+ **************************************************************************/
+
+uint32_t delay_now(){
+    uint16_t low = _DELAY_TMR;
+    return ((uint32_t) _DELAY_HLD << 16) | low;
+}
+
+/**
+ * @param deadline Time to wait for as given by delay_now().
+ *
+ * @brief Stalls execution until the given time.
+ *
+ * Returns at once if the deadline has already passed, as long as it is
+ * less than half the range of the timer behind.
+ *
+ * @return none
+ **************************************************************************/
+
+void delay_until(uint32_t deadline){
+    while((int32_t) (delay_now() - deadline) < 0);
+}
+
+/**
+ * @brief Measures the overhead of a call to delay_us().
+ *
+ * Times a call to delay_us() with interrupts held off and compares it
+ * with the cycles asked for. The time taken to read the timer is measured
+ * separately and left out.
+ *
+ * @return The value _DELAY_OVERHEAD should have for this build.
+ **************************************************************************/
+
+int16_t delay_overhead(){
+    uint32_t start, base, taken;
+
+    __builtin_disi(0x3fff);
+    start = delay_now();
+    base = delay_now() - start;
+    start = delay_now();
+    delay_us(_DELAY_TEST_US);
+    taken = delay_now() - start - base;
+    DISICNT = 0;
+
+    return _DELAY_OVERHEAD + (int16_t) (taken - DELAY_US(_DELAY_TEST_US));
+}
+
+/**
+ * @brief Measures the overhead of a delay_us() with a runtime argument.
+ *
+ * Same as delay_overhead() with the time read from a variable, so the
+ * delay goes through **__delay_run()**. The result is only exact when Fcy
+ * is a whole number of MHz, otherwise it also holds the cycles added by
+ * rounding up the cycles per microsecond.
+ *
+ * @return The value _DELAY_RUN_OVERHEAD should have for this build.
+ **************************************************************************/
+
+int16_t delay_run_overhead(){
+    volatile uint16_t us = _DELAY_TEST_US;
+    uint32_t start, base, taken;
+
+    __builtin_disi(0x3fff);
+    start = delay_now();
+    base = delay_now() - start;
+    start = delay_now();
+    delay_us(us);
+    taken = delay_now() - start - base;
+    DISICNT = 0;
+
+    return _DELAY_RUN_OVERHEAD + (int16_t) (taken - DELAY_US(_DELAY_TEST_US));
+}
+
+#endif
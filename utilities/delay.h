@@ -0,0 +1,41 @@
+/**
+ * @file  delay.h
+ * @brief This file contains function wrappers for timer based delays
+ * @author Jaime Bronozo
+ *
+ * This is a header file for delay.c which must be included to any source
+ * files that require delays that stay accurate when interrupts are taken.
+ * This library is dynamically included in the main header
+ * PIC24_toolbox.h
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+#ifndef __DELAY_TOOLBOX_H__
+#define __DELAY_TOOLBOX_H__
+
+/**
+ * @def DELAY_US(d)
+ * @param d Time in unit microseconds.
+ *
+ * @brief Converts microseconds to counts of delay_now(), rounded up.
+ *
+ * @def DELAY_MS(d)
+ * @param d Time in unit milliseconds.
+ *
+ * @brief Converts milliseconds to counts of delay_now(), rounded up.
+ *
+ * Both are folded by the compiler when given a constant. Deadlines must
+ * be less than half the range of the counter ahead, about 134 seconds at
+ * an Fcy of 16 MHz.
+ **************************************************************************/
+#define DELAY_US(d) ((uint32_t) __DELAY_CYCLES(d, 1000000ULL))
+#define DELAY_MS(d) ((uint32_t) __DELAY_CYCLES(d, 1000ULL))
+
+void delay_begin();
+uint32_t delay_now();
+void delay_until(uint32_t deadline);
+int16_t delay_overhead();
+int16_t delay_run_overhead();
+
+#endif
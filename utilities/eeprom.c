@@ -20,6 +20,10 @@
 #include "toolbox_settings.h"
 #include "eeprom.h"
 
+#if __LIBI2C_ASYNC_DISABLE != 1
+#include "i2c_async.h"
+#endif
+
 #if __LIBEEPROM_I2C_DISABLE != 1
 /// @endcond
 #define _EEPROM_BRG __I2C_BRG(_I2C_NUM)
@@ -28,42 +32,283 @@
 #define _EEPROM_TRN __I2C_TRN(_I2C_NUM)
 #define _EEPROM_RCV __I2C_RCV(_I2C_NUM)
 
-#define __BUSCOL I2C1STATbits.BCL
+#define __BUSCOL _EEPROM_STAT.BCL
 #define _ACK 0
 #define _NACK 1
 
-#define _START1 0x100
-#define _START2 0x200
-#define _RSTART 0x300
-#define _SEND 0x400
-#define _STOP 0x500
-#define _INIT 0x600
-#define _SENDACK 0x600
-#define _WSEND1 0x1000
-#define _WSEND2 0x2000
-#define _WRITE_START 0x10000
-#define _WRITE_CALL 0x20000
-#define _WRITE_ADDR 0x30000
-#define _WRITE_SEND 0x40000
-#define _WRITE_STOP 0x50000
-#define _READ_START 0x60000
-#define _READ_CALL 0x70000
-#define _READ_ADDR 0x80000
-#define _READ_RSTART 0x90000
-#define _READ_RADDR 0xA0000
-#define _READ_NACK 0xB0000
-#define _READ_END 0xC0000
-#define _POLL_START 0xD0000
-#define _POLL_SEND 0xE0000
-#define _POLL_STOP 0xF0000
 
 
 #define ADDR_READ(x) 0xa1 | ((x) << 1)
 #define ADDR_WRITE(x) 0xa0 | ((x) << 1)
 
+#if (_EEPROM_PAGE_SIZE & (_EEPROM_PAGE_SIZE - 1)) != 0
+#error "_EEPROM_PAGE_SIZE must be a power of two"
+#endif
+
+/*
+ * Baud rate from the target SCL frequency. The FCY / 10000000 term is
+ * the delay of the pulse gobbler on the SCL input which lengthens every
+ * SCL period by about 100ns. The division is rounded up so the bus never
+ * runs faster than _I2C_SCL_HZ. _CLOCK_RATE overrides the computation.
+ */
+#if _I2C_SOFTWARE == 1
+#define __EEPROM_SCL_CYCLES ((FCY + _I2C_SCL_HZ - 1) / _I2C_SCL_HZ)
+#else
+#ifdef _CLOCK_RATE
+#define __EEPROM_BRG (_CLOCK_RATE)
+#else
+#define __EEPROM_BRG ((FCY + _I2C_SCL_HZ - 1) / _I2C_SCL_HZ - FCY / 10000000 - 1)
+#endif
+
+#define __EEPROM_SCL_CYCLES (__EEPROM_BRG + 1 + FCY / 10000000)
+
+#if __EEPROM_BRG < 2 || __EEPROM_BRG > 511
+#error "_I2C_SCL_HZ cannot be reached at this FCY"
+#endif
+#endif
+
+#define __EEPROM_SCL_HZ (FCY / __EEPROM_SCL_CYCLES)
+
+#if __EEPROM_SCL_HZ > 1000000
+#error "_I2C_SCL_HZ is above the 1MHz of Fast-mode Plus"
+#endif
+
+#if !defined(_CLOCK_RATE) && __EEPROM_SCL_HZ * 10 < _I2C_SCL_HZ * 9
+#warning "the I2C clock is more than 10% below _I2C_SCL_HZ at this FCY"
+#endif
+
+/*
+ * The software master drives the pins as open drain by switching them
+ * between output low and input. Each half of an SCL period is a delay
+ * less the cycles spent by the code around it, about 20 cycles.
+ */
+#if _I2C_SOFTWARE == 1
+#if __LIBI2C_ASYNC_DISABLE != 1
+#error "i2c_async.c needs the I2C module, disable it with _I2C_SOFTWARE"
+#endif
+
+#define __SDA_LOW() (__TRISx(_I2C_SDA) = 0)
+#define __SDA_RELEASE() (__TRISx(_I2C_SDA) = 1)
+#define __SCL_LOW() (__TRISx(_I2C_SCL) = 0)
+#define __SCL_RELEASE() (__TRISx(_I2C_SCL) = 1)
+
+#define __EEPROM_HALF_BIT (__EEPROM_SCL_CYCLES / 2 - 20)
+
+#if __EEPROM_HALF_BIT >= 12
+#define __eeprom_half_bit() __delay32(__EEPROM_HALF_BIT)
+#elif __EEPROM_HALF_BIT > 0
+#define __eeprom_half_bit() do{ \
+        int __n; \
+        for(__n = __EEPROM_HALF_BIT / 4; __n > 0; __n--){ \
+            Nop(); \
+        } \
+    }while(0)
+#else
+#define __eeprom_half_bit()
+#endif
+
+#if __EEPROM_HALF_BIT < 0
+#warning "_I2C_SCL_HZ is too fast for the software I2C master at this FCY"
+#endif
+#endif
+
+// slew rate control is meant for 400kHz only
+#if __EEPROM_SCL_HZ > 100000 && __EEPROM_SCL_HZ <= 400000
+#define __EEPROM_DISSLW 0
+#else
+#define __EEPROM_DISSLW 1
+#endif
+
+/*
+ * Number of control bytes that fit in _EEPROM_WRITE_TIMEOUT_US when
+ * polling for the end of a write cycle. Each poll is a repeated start and
+ * a control byte, which is about 11 SCL periods.
+ */
+#define __EEPROM_POLL_LIMIT (_EEPROM_WRITE_TIMEOUT_US * 1ULL * \
+        __EEPROM_SCL_HZ / 11000000ULL + 1)
+
+/*
+ * Bound for every wait on a flag of the I2C module, in loop iterations.
+ * A byte takes 9 SCL periods and the bound is 4 byte times counted with
+ * the fastest wait loop of 3 cycles, so a wait gives up after 4 to about
+ * 8 byte times depending on the loop generated by the compiler.
+ */
+#define __EEPROM_WAIT_LIMIT (4UL * 9 * __EEPROM_SCL_CYCLES / 3)
+
+#if __EEPROM_WAIT_LIMIT > 0xffff
+#error "the I2C clock is too slow for the I2C wait bound"
+#endif
+
+#define __EEPROM_WAIT(flag, stage) \
+    for(wait = 0; flag; wait++){ \
+        if(wait == __EEPROM_WAIT_LIMIT){ \
+            return __eeprom_timeout(stage); \
+        } \
+    } \
+    if(wait > eeprom_wait_peak[(stage) >> 8]){ \
+        eeprom_wait_peak[(stage) >> 8] = wait; \
+    } \
+    eeprom_op_wait += wait;
+
 int __eeprom_bus_recover();
+int __eeprom_stop();
+int __eeprom_wait_write(char dev_address);
 
 uint32_t eeprom_errno = 0;
+uint8_t eeprom_pending = 0;
+uint8_t eeprom_service_dev = 0;
+#if __LIBI2C_ASYNC_DISABLE != 1
+i2c_txn_t eeprom_async_txn;
+i2c_txn_t eeprom_service_txn;
+eeprom_async_t *eeprom_async_owner = 0;
+#endif
+uint16_t eeprom_wait_peak[8];
+uint32_t eeprom_op_wait = 0;
+eeprom_stats_t eeprom_stats;
+uint16_t eeprom_crc_sent = 0;
+
+/**
+ * @brief Clock frequency of the I2C bus.
+ *
+ * Frequency in Hz reached with the baud rate computed from _I2C_SCL_HZ
+ * and FCY, or set by _CLOCK_RATE.
+ **************************************************************************/
+const uint32_t eeprom_scl_hz = __EEPROM_SCL_HZ;
+
+/**
+ * @brief Highest transfer rate of the I2C bus.
+ *
+ * Number of bytes per second moved during a sequential read, where each
+ * byte takes 9 SCL periods. Addressing and write cycles come on top of
+ * this.
+ **************************************************************************/
+const uint32_t eeprom_byte_rate = __EEPROM_SCL_HZ / 9;
+
+/*
+ * CRC-16/GSM (polynomial 0x1021, initial value 0, result inverted) is
+ * used since the hardware CRC module can only start from 0. Inverting
+ * the result keeps a block of zeros read from a stuck bus from passing.
+ */
+uint8_t eeprom_crc_on = 0;
+uint16_t eeprom_crc_frame = 0;
+
+#ifdef _CRCGO
+/*
+ * The module shifts each data bit into the bottom of its register and
+ * applies the polynomial to the bit leaving the top, which gives the
+ * remainder of the data alone. eeprom_crc_table, like the usual CRC,
+ * gives the remainder of the data followed by 16 zero bits.
+ * __eeprom_crc_end() feeds the module one word of zeros so both give the
+ * same result, as a bit-level model of the module fed the same blocks as
+ * the table confirms.
+ */
+#define __EEPROM_CRC_PLEN 15
+
+// the shifter takes 2 bits per instruction cycle after the FIFO
+#define __EEPROM_CRC_SHIFT_CYCLES ((__EEPROM_CRC_PLEN + 1) / 2)
+
+uint8_t eeprom_crc_odd = 0;
+uint8_t eeprom_crc_hold = 0;
+
+void __eeprom_crc_begin(){
+    CRCCONbits.CRCGO = 0;
+    CRCCONbits.PLEN = __EEPROM_CRC_PLEN;
+    CRCXOR = 0x1021;
+    CRCWDAT = 0;
+    CRCCONbits.CRCGO = 1;
+    eeprom_crc_odd = 0;
+    eeprom_crc_on = 1;
+}
+
+void __eeprom_crc_update(uint8_t data){
+    // the module takes 16-bit words for a 16-bit polynomial
+    if(!eeprom_crc_odd){
+        eeprom_crc_hold = data;
+        eeprom_crc_odd = 1;
+        return;
+    }
+    while(CRCCONbits.CRCFUL);
+    CRCDAT = ((uint16_t) eeprom_crc_hold << 8) | data;
+    eeprom_crc_odd = 0;
+}
+
+uint16_t __eeprom_crc_end(){
+    uint16_t crc;
+    int i;
+
+    // a word of zeros shifts the last data word through the register
+    while(CRCCONbits.CRCFUL);
+    CRCDAT = 0;
+
+    // CRCMPT is set as the word of zeros leaves the FIFO, before it is
+    // shifted through, so the shifter is given its time before stopping
+    while(!CRCCONbits.CRCMPT);
+    delay_cycles(__EEPROM_CRC_SHIFT_CYCLES);
+    CRCCONbits.CRCGO = 0;
+    crc = CRCWDAT;
+
+    if(eeprom_crc_odd){
+        crc ^= (uint16_t) eeprom_crc_hold << 8;
+        for(i = 0; i < 8; i++){
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    eeprom_crc_on = 0;
+    return crc ^ 0xffff;
+}
+#else
+const uint16_t eeprom_crc_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
+};
+
+uint16_t eeprom_crc_value = 0;
+
+void __eeprom_crc_begin(){
+    eeprom_crc_value = 0;
+    eeprom_crc_on = 1;
+}
+
+void __eeprom_crc_update(uint8_t data){
+    eeprom_crc_value = (eeprom_crc_value << 8) ^
+            eeprom_crc_table[(eeprom_crc_value >> 8) ^ data];
+}
+
+uint16_t __eeprom_crc_end(){
+    eeprom_crc_on = 0;
+    return eeprom_crc_value ^ 0xffff;
+}
+#endif
 
 short unsigned int EEPROM_error(){
     return eeprom_errno & 0xff;
@@ -77,7 +322,156 @@ short unsigned int EEPROM_error3(){
     return (eeprom_errno >> 8) & 0xff;
 }
 
+/**
+ * @param stage One of EEPROM_STAGE_START1, EEPROM_STAGE_START2,
+ * EEPROM_STAGE_RSTART, EEPROM_STAGE_SEND, EEPROM_STAGE_RECEIVE,
+ * EEPROM_STAGE_STOP or EEPROM_STAGE_SENDACK.
+ * 
+ * @brief Gives the longest wait seen on an I2C flag.
+ * 
+ * Every wait on a flag of the I2C module is counted in loop iterations
+ * and the highest count of each kind of wait is kept. A wait gives up at
+ * a bound computed from the I2C clock and FCY, see the I2C EEPROM settings
+ * page for the worst case latency of each primitive.
+ * 
+ * @return The highest number of loop iterations since the start of the
+ * program.
+ **************************************************************************/
+
+uint16_t EEPROM_wait_peak(uint32_t stage){
+    return eeprom_wait_peak[(stage >> 8) & 7];
+}
+
+int __eeprom_timeout(uint32_t stage){
+    eeprom_stats.timeouts++;
+    if(__eeprom_bus_recover() < 0){
+        eeprom_errno = _EEPROM_FATAL_ERROR | stage;
+    }
+    else{
+        eeprom_errno = _EEPROM_BUS_TIMEOUT | stage;
+    }
+    return -1;
+}
+
+int __eeprom_may_retry(int *tries, uint8_t pending){
+    // timeouts and collisions are tried again once the bus is free
+    switch(EEPROM_error()){
+        case _EEPROM_BUS_TIMEOUT:
+        case _EEPROM_BUS_COLLISION:
+        case _EEPROM_WRITE_BUF_COLLISION:
+            break;
+        default:
+            return 0;
+    }
+    if(*tries >= _EEPROM_RETRIES){
+        return 0;
+    }
+    (*tries)++;
+    eeprom_stats.retries++;
+
+    // an interrupted write may still have started a write cycle
+    eeprom_pending |= pending;
+    return 1;
+}
+
+void __eeprom_release(){
+    uint32_t error = eeprom_errno;
+
+    // a transfer given up half way still holds the bus
+    switch(EEPROM_error()){
+        case _EEPROM_NOT_RESPONDING:
+            __eeprom_stop();
+            break;
+        case _EEPROM_BUS_COLLISION:
+        case _EEPROM_WRITE_BUF_COLLISION:
+        case _EEPROM_READ_BUF_OVERFLOW:
+            if(__eeprom_bus_recover() < 0){
+                error = (error & ~0xffUL) | _EEPROM_FATAL_ERROR;
+            }
+            break;
+    }
+    eeprom_errno = error;
+}
+
+int __eeprom_retry(int *tries, uint8_t pending){
+    __eeprom_release();
+    return __eeprom_may_retry(tries, pending);
+}
+
+void __eeprom_op_begin(){
+    eeprom_op_wait = 0;
+}
+
+void __eeprom_op_count(uint8_t op, int fval){
+    eeprom_stats.operations[op]++;
+    if(fval >= 0){
+        return;
+    }
+
+    eeprom_stats.failures++;
+    switch(EEPROM_error()){
+        case _EEPROM_NOT_RESPONDING:
+            eeprom_stats.nacks++;
+            break;
+        case _EEPROM_BUS_COLLISION:
+        case _EEPROM_WRITE_BUF_COLLISION:
+            eeprom_stats.collisions++;
+            break;
+    }
+    eeprom_stats.last_error = eeprom_errno;
+    eeprom_stats.last_operation = op;
+}
+
+void __eeprom_op_end(uint8_t op, int fval){
+    uint32_t wait = eeprom_op_wait;
+    uint8_t bucket = 0;
+
+    while(wait >= 64 && bucket < EEPROM_BUCKETS - 1){
+        wait >>= 2;
+        bucket++;
+    }
+    if(eeprom_stats.latency[op][bucket] != 0xffff){
+        eeprom_stats.latency[op][bucket]++;
+    }
+    __eeprom_op_count(op, fval);
+}
+
+/**
+ * @brief Gives the error and statistics block of the EEPROM library.
+ * 
+ * The counters are kept from the start of the program or the last call
+ * to EEPROM_stats_clear(). A bus getting worse shows up as growing
+ * retry, recovery and timeout counts and as operations moving to higher
+ * latency buckets well before transfers start to fail.
+ * 
+ * @return A pointer to the statistics, which must not be changed.
+ **************************************************************************/
+
+const eeprom_stats_t *EEPROM_stats(){
+    return &eeprom_stats;
+}
+
+/**
+ * @brief Clears the error and statistics block.
+ * 
+ * @return none
+ **************************************************************************/
+
+void EEPROM_stats_clear(){
+    uint8_t *p = (uint8_t *) &eeprom_stats;
+    uint16_t i;
+    for(i = 0; i < sizeof(eeprom_stats); i++){
+        p[i] = 0;
+    }
+}
+
+#if _I2C_SOFTWARE != 1
 int __eeprom_start(){
+    uint16_t wait;
+#if __LIBI2C_ASYNC_DISABLE != 1
+    // let queued background transactions finish first
+    i2c_flush();
+#endif
     if(__BUSCOL){
         if(__eeprom_bus_recover() < 0){
             eeprom_errno = _EEPROM_FATAL_ERROR;
@@ -90,347 +484,904 @@ int __eeprom_start(){
     do{
         if(__BUSCOL){
             if(__eeprom_bus_recover() < 0){
-                eeprom_errno = _EEPROM_FATAL_ERROR | _START1;
+                eeprom_errno = _EEPROM_FATAL_ERROR | EEPROM_STAGE_START1;
                 return -1;
             }
             _EEPROM_CON.SEN = 0;
             __BUSCOL = 0;
-            continue;
+            _EEPROM_CON.SEN = 1;
+            Nop();
         }
         else if(_EEPROM_STAT.IWCOL){
-            eeprom_errno = _EEPROM_WRITE_BUF_COLLISION | _START1;
+            eeprom_errno = _EEPROM_WRITE_BUF_COLLISION | EEPROM_STAGE_START1;
             return -1;
         }
-        while(_EEPROM_CON.SEN);
+        __EEPROM_WAIT(_EEPROM_CON.SEN, EEPROM_STAGE_START2);
     }while(0);
     if(__BUSCOL){
-        eeprom_errno = _EEPROM_BUS_COLLISION | _START2;
+        eeprom_errno = _EEPROM_BUS_COLLISION | EEPROM_STAGE_START2;
         return -1;
     }
     return 0;
 }
 
 int __eeprom_restart(){
+    uint16_t wait;
     __BUSCOL = 0;
     _EEPROM_CON.RSEN = 1;
     Nop();
     if(__BUSCOL){
-        eeprom_errno = _EEPROM_BUS_COLLISION | _RSTART;
+        eeprom_errno = _EEPROM_BUS_COLLISION | EEPROM_STAGE_RSTART;
         return -1;
     }
-    while(_EEPROM_CON.RSEN);
+    __EEPROM_WAIT(_EEPROM_CON.RSEN, EEPROM_STAGE_RSTART);
     return 0;
 }
 
 int __eeprom_bus_recover(){
     int i;
 
+    eeprom_stats.recoveries++;
     _EEPROM_CON.RCEN = 0;
     _EEPROM_STAT.IWCOL = 0;
     _EEPROM_STAT.BCL = 0;
 
+    // with the module off the pins are driven as open drain through TRIS
     _EEPROM_CON.I2CEN = 0;
-    __LATx(_I2C_SDA) = 1;
-    __LATx(_I2C_SCL) = 1;
+    __LATx(_I2C_SDA) = 0;
+    __LATx(_I2C_SCL) = 0;
+    __TRISx(_I2C_SDA) = 1;
+    __TRISx(_I2C_SCL) = 1;
 
     delay_us(10);
     if(__PORTx(_I2C_SCL) == 0){
         return -1;
     }
 
-    for(i = 10; i > 0; i--){
-        if(__PORTx(_I2C_SDA)){
-            break;
-        }\
-
-        __LATx(_I2C_SCL) = 0;
+    for(i = 10; i > 0 && !__PORTx(_I2C_SDA); i--){
+        __TRISx(_I2C_SCL) = 0;
         delay_us(10);
-        __LATx(_I2C_SCL) = 1;
+        __TRISx(_I2C_SCL) = 1;
         delay_us(10);
     }
-    if(!__LATx(_I2C_SCL) || !__LATx(_I2C_SDA)){
+    if(!__PORTx(_I2C_SDA)){
         return -2;
     }
 
-    __LATx(_I2C_SDA) = 0;
+    __TRISx(_I2C_SDA) = 0;
     delay_us(10);
-    __LATx(_I2C_SDA) = 1;
+    __TRISx(_I2C_SDA) = 1;
     delay_us(10);
     _EEPROM_CON.I2CEN = 1;
     return 0;
 }
 
 int __eeprom_byte_send(char data){
+    uint16_t wait;
     __BUSCOL = 0;
     _EEPROM_TRN = data;
-    while(_EEPROM_STAT.TRSTAT);
+    __EEPROM_WAIT(_EEPROM_STAT.TRSTAT, EEPROM_STAGE_SEND);
     if(__BUSCOL){
-        eeprom_errno = _EEPROM_BUS_COLLISION | _SEND;
+        eeprom_errno = _EEPROM_BUS_COLLISION | EEPROM_STAGE_SEND;
         return -1;
     }
+    eeprom_stats.bytes_sent++;
     return _EEPROM_STAT.ACKSTAT;
 }
+#else
+int __eeprom_start(){
+    uint16_t wait;
+    __SDA_RELEASE();
+    __SCL_RELEASE();
+    __EEPROM_WAIT(!__PORTx(_I2C_SCL), EEPROM_STAGE_START1);
+
+    // a slave holding SDA low is still in the middle of a transfer
+    if(!__PORTx(_I2C_SDA)){
+        if(__eeprom_bus_recover() < 0){
+            eeprom_errno = _EEPROM_FATAL_ERROR | EEPROM_STAGE_START1;
+            return -1;
+        }
+    }
+    __eeprom_half_bit();
+    __SDA_LOW();
+    __eeprom_half_bit();
+    __SCL_LOW();
+    return 0;
+}
+
+int __eeprom_restart(){
+    uint16_t wait;
+    __SDA_RELEASE();
+    __eeprom_half_bit();
+    __SCL_RELEASE();
+    __EEPROM_WAIT(!__PORTx(_I2C_SCL), EEPROM_STAGE_RSTART);
+    if(!__PORTx(_I2C_SDA)){
+        eeprom_errno = _EEPROM_BUS_COLLISION | EEPROM_STAGE_RSTART;
+        return -1;
+    }
+    __eeprom_half_bit();
+    __SDA_LOW();
+    __eeprom_half_bit();
+    __SCL_LOW();
+    return 0;
+}
+
+int __eeprom_bus_recover(){
+    int i;
+
+    eeprom_stats.recoveries++;
+    __SDA_RELEASE();
+    __SCL_RELEASE();
+    delay_us(10);
+    if(__PORTx(_I2C_SCL) == 0){
+        return -1;
+    }
+
+    for(i = 10; i > 0 && !__PORTx(_I2C_SDA); i--){
+        __SCL_LOW();
+        delay_us(10);
+        __SCL_RELEASE();
+        delay_us(10);
+    }
+    if(!__PORTx(_I2C_SDA)){
+        return -2;
+    }
+
+    __SDA_LOW();
+    delay_us(10);
+    __SDA_RELEASE();
+    delay_us(10);
+    return 0;
+}
+
+int __eeprom_bit(uint8_t bit, uint32_t stage){
+    uint16_t wait;
+    if(bit){
+        __SDA_RELEASE();
+    }
+    else{
+        __SDA_LOW();
+    }
+    __eeprom_half_bit();
+    __SCL_RELEASE();
+    __EEPROM_WAIT(!__PORTx(_I2C_SCL), stage);
+    bit = __PORTx(_I2C_SDA);
+    __eeprom_half_bit();
+    __SCL_LOW();
+
+    // counts as the wait loop iterations of one bit time
+    eeprom_op_wait += __EEPROM_SCL_CYCLES / 3;
+    return bit;
+}
+
+int __eeprom_byte_send(char data){
+    int i, bit;
+    for(i = 7; i >= 0; i--){
+        bit = __eeprom_bit((data >> i) & 1, EEPROM_STAGE_SEND);
+        if(bit < 0){
+            return -1;
+        }
+        if(bit != ((data >> i) & 1)){
+            __SDA_RELEASE();
+            eeprom_errno = _EEPROM_BUS_COLLISION | EEPROM_STAGE_SEND;
+            return -1;
+        }
+    }
+    eeprom_stats.bytes_sent++;
+    return __eeprom_bit(1, EEPROM_STAGE_SEND);
+}
+#endif
 
 int __eeprom_word_send(int16_t data){
     int ack1 = 0, ack2 = 0;
     ack1 = __eeprom_byte_send(data >> 8);
     if(ack1 == -1){
-        eeprom_errno |= _WSEND1;
+        eeprom_errno |= EEPROM_STAGE_WSEND1;
         return -1;
     }
     ack2 = __eeprom_byte_send(data & 0xff);
     if(ack2 == -1){
-        eeprom_errno |= _WSEND2;
+        eeprom_errno |= EEPROM_STAGE_WSEND2;
         return -1;
     }
     return (ack1 << 1) | ack2;
 }
 
+#if _I2C_SOFTWARE != 1
 int __eeprom_byte_receive(){
-    int count = 0;
+    uint16_t wait;
     _EEPROM_CON.RCEN = 1;
-    while(!_EEPROM_STAT.RBF);/*{
-        if(count++ == 0xffff){
-            eeprom_errno = _EEPROM_READ_TIMEOUT;
-            return -1;
-        }
-    }*/
+    __EEPROM_WAIT(!_EEPROM_STAT.RBF, EEPROM_STAGE_RECEIVE);
+    eeprom_stats.bytes_received++;
     return _EEPROM_RCV;
 }
 
 int __eeprom_read_ack(char ack){
+    uint16_t wait;
     _EEPROM_CON.ACKDT = ack;
     _EEPROM_CON.ACKEN = 1;
 
     if(_EEPROM_STAT.I2COV){
-        eeprom_errno = _EEPROM_READ_BUF_OVERFLOW | _SENDACK;
+        eeprom_errno = _EEPROM_READ_BUF_OVERFLOW | EEPROM_STAGE_SENDACK;
         return -1;
     }
 
-    while(_EEPROM_CON.ACKEN);
+    __EEPROM_WAIT(_EEPROM_CON.ACKEN, EEPROM_STAGE_SENDACK);
     return 0;
 }
 
 int __eeprom_stop(){
+    uint16_t wait;
     __BUSCOL = 0;
     _EEPROM_CON.PEN = 1;
     Nop();
     if(__BUSCOL){
-        eeprom_errno = _EEPROM_BUS_COLLISION | _STOP;
+        eeprom_errno = _EEPROM_BUS_COLLISION | EEPROM_STAGE_STOP;
         //return -1;
     }
-    while(_EEPROM_CON.PEN);
+    __EEPROM_WAIT(_EEPROM_CON.PEN, EEPROM_STAGE_STOP);
     return 0;
 }
 
 void EEPROM_begin(){
-    _EEPROM_BRG = _CLOCK_RATE;
+    _EEPROM_BRG = __EEPROM_BRG;
+    _EEPROM_CON.DISSLW = __EEPROM_DISSLW;
 
     _EEPROM_CON.I2CEN = 1;
     _EEPROM_STAT.BCL = 0;
 }
+#else
+int __eeprom_byte_receive(){
+    int i, bit, data = 0;
+    for(i = 0; i < 8; i++){
+        bit = __eeprom_bit(1, EEPROM_STAGE_RECEIVE);
+        if(bit < 0){
+            return -1;
+        }
+        data = (data << 1) | bit;
+    }
+    eeprom_stats.bytes_received++;
+    return data;
+}
+
+int __eeprom_read_ack(char ack){
+    if(__eeprom_bit(ack, EEPROM_STAGE_SENDACK) < 0){
+        return -1;
+    }
+    __SDA_RELEASE();
+    return 0;
+}
+
+int __eeprom_stop(){
+    uint16_t wait;
+    __SDA_LOW();
+    __eeprom_half_bit();
+    __SCL_RELEASE();
+    __EEPROM_WAIT(!__PORTx(_I2C_SCL), EEPROM_STAGE_STOP);
+    __eeprom_half_bit();
+    __SDA_RELEASE();
+    __eeprom_half_bit();
+    if(!__PORTx(_I2C_SDA)){
+        eeprom_errno = _EEPROM_BUS_COLLISION | EEPROM_STAGE_STOP;
+    }
+    return 0;
+}
+
+void EEPROM_begin(){
+    __LATx(_I2C_SDA) = 0;
+    __LATx(_I2C_SCL) = 0;
+    __SDA_RELEASE();
+    __SCL_RELEASE();
+}
+#endif
 
-int EEPROM_write(char data, uint16_t mem_address, char dev_address){
+int __eeprom_write_byte(char data, uint16_t mem_address, char dev_address){
     int fval;
+    if(__eeprom_wait_write(dev_address)){
+        return -1;
+    }
+
     if(__eeprom_start()){
-        eeprom_errno |= _WRITE_START;
+        eeprom_errno |= EEPROM_STAGE_WRITE_START;
         return -1;
     }
 
     fval = __eeprom_byte_send(ADDR_WRITE(dev_address));
     if(fval == -1){
-        eeprom_errno |= _WRITE_CALL;
+        eeprom_errno |= EEPROM_STAGE_WRITE_CALL;
         return -1;
     }
     else if(fval == _NACK){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _WRITE_CALL;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_WRITE_CALL;
         return -1;
     }
 
     fval = __eeprom_word_send((int16_t) mem_address);
     if(fval == -1){
-        eeprom_errno |= _WRITE_ADDR;
+        eeprom_errno |= EEPROM_STAGE_WRITE_ADDR;
         return -1;
     }
     else if(fval > 0){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _WRITE_ADDR;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_WRITE_ADDR;
         return -1;
     }
 
     fval = __eeprom_byte_send(data);
     if(fval == -1){
-        eeprom_errno |= _WRITE_SEND;
+        eeprom_errno |= EEPROM_STAGE_WRITE_SEND;
         return -1;
     }
     else if(fval == _NACK){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _WRITE_SEND;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_WRITE_SEND;
         return -1;
     }
 
     if(__eeprom_stop()){
-        eeprom_errno |= _WRITE_STOP;
+        eeprom_errno |= EEPROM_STAGE_WRITE_STOP;
         return -1;
     }
+    eeprom_pending |= 1 << dev_address;
     return 0;
 }
 
-int EEPROM_write_page(char *data, int size, uint16_t mem_address, char dev_address){
+int EEPROM_write_byte(char data, uint16_t mem_address, char dev_address){
+    int fval, tries = 0;
+    __eeprom_op_begin();
+    while((fval = __eeprom_write_byte(data, mem_address, dev_address)) < 0){
+        if(!__eeprom_retry(&tries, 1 << dev_address)){
+            break;
+        }
+    }
+    __eeprom_op_end(EEPROM_OP_WRITE_BYTE, fval);
+    return fval;
+}
+
+int __eeprom_write_page(char *data, int size, uint16_t mem_address, char dev_address){
     int fval, count;
+    if(__eeprom_wait_write(dev_address)){
+        return -1;
+    }
+
     if(__eeprom_start()){
-        eeprom_errno |= _WRITE_START;
+        eeprom_errno |= EEPROM_STAGE_WRITE_START;
         return -1;
     }
 
     fval = __eeprom_byte_send(ADDR_WRITE(dev_address));
     if(fval == -1){
-        eeprom_errno |= _WRITE_CALL;
+        eeprom_errno |= EEPROM_STAGE_WRITE_CALL;
         return -1;
     }
     else if(fval == _NACK){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _WRITE_CALL;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_WRITE_CALL;
         return -1;
     }
 
     fval = __eeprom_word_send((int16_t) mem_address);
     if(fval == -1){
-        eeprom_errno |= _WRITE_ADDR;
+        eeprom_errno |= EEPROM_STAGE_WRITE_ADDR;
         return -1;
     }
     else if(fval > 0){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _WRITE_ADDR;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_WRITE_ADDR;
         return -1;
     }
 
     for(count = 0; count < size; count++){
+        // bytes sent before a retry are not added to the CRC again
+        if(eeprom_crc_on && count == eeprom_crc_sent){
+            __eeprom_crc_update(data[count]);
+            eeprom_crc_sent++;
+        }
        fval = __eeprom_byte_send(data[count]);
         if(fval == -1){
-            eeprom_errno |= _WRITE_SEND;
+            eeprom_errno |= EEPROM_STAGE_WRITE_SEND;
             return -1;
         }
         else if(fval == _NACK){
-            eeprom_errno = _EEPROM_NOT_RESPONDING | _WRITE_SEND;
+            eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_WRITE_SEND;
             return -1;
         } 
     }
 
     if(__eeprom_stop()){
-        eeprom_errno |= _WRITE_STOP;
+        eeprom_errno |= EEPROM_STAGE_WRITE_STOP;
         return -1;
     }
+    eeprom_pending |= 1 << dev_address;
     return count;
 }
 
-int EEPROM_read(uint16_t mem_address, char dev_address){
+int EEPROM_write_page(char *data, int size, uint16_t mem_address, char dev_address){
+    int fval, tries = 0;
+    __eeprom_op_begin();
+    eeprom_crc_sent = 0;
+    while((fval = __eeprom_write_page(data, size, mem_address, dev_address)) < 0){
+        if(!__eeprom_retry(&tries, 1 << dev_address)){
+            break;
+        }
+    }
+    __eeprom_op_end(EEPROM_OP_WRITE_PAGE, fval);
+    return fval;
+}
+
+/**
+ * @param op State of the coroutine, zeroed or set up with TB_INIT() on
+ * op->thread before the first call.
+ * @param data Bytes to be written.
+ * @param size Number of bytes to write, not crossing a page boundary.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ * 
+ * @brief Writes a page without waiting.
+ * 
+ * The coroutine version of EEPROM_write_page(). The write cycle of the
+ * chip is polled once per call instead of in a loop. With the
+ * asynchronous I2C library the page is then sent from the interrupt
+ * through a transaction owned by this library, which a single coroutine
+ * uses at a time. Otherwise it is sent by EEPROM_write_page() once the
+ * chip is ready. Must be called again with the same arguments until it
+ * returns #TB_DONE, after which op->result holds what EEPROM_write_page()
+ * would have returned.
+ * 
+ * @return #TB_WAITING while the write is in progress or #TB_DONE once it
+ * is over.
+ **************************************************************************/
+
+int EEPROM_write_page_async(eeprom_async_t *op, char *data, int size, uint16_t mem_address, char dev_address){
+    TB_BEGIN(&op->thread);
+    op->tries = 0;
+#if __LIBI2C_ASYNC_DISABLE != 1
+    do{
+        // polling the chip while the queue is busy would wait for it
+        TB_AWAIT(!eeprom_async_owner && !i2c_busy()
+                && EEPROM_write_done(dev_address) != 0);
+        eeprom_async_owner = op;
+        i2c_eeprom_write(&eeprom_async_txn, data, size, mem_address, dev_address);
+        eeprom_async_txn.done = 0;
+        i2c_submit(&eeprom_async_txn);
+        TB_AWAIT(i2c_done(&eeprom_async_txn));
+        eeprom_async_owner = 0;
+
+        if(eeprom_async_txn.status == I2C_DONE){
+            op->result = size;
+        }
+        else{
+            eeprom_errno = eeprom_async_txn.error;
+            op->result = -1;
+        }
+    } while(op->result < 0 && __eeprom_may_retry(&op->tries, 1 << dev_address));
+    // nothing waits in a loop, so there is no latency to add to the histogram
+    __eeprom_op_count(EEPROM_OP_WRITE_PAGE, op->result);
+#else
+    TB_AWAIT(EEPROM_write_done(dev_address) != 0);
+    op->result = EEPROM_write_page(data, size, mem_address, dev_address);
+#endif
+    TB_END();
+}
+
+/**
+ * @param data Bytes to be written.
+ * @param size Number of bytes to write.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ * 
+ * @brief Writes a buffer of any length.
+ * 
+ * Splits the buffer at every page boundary of _EEPROM_PAGE_SIZE so that
+ * no page write wraps around, and sends each piece as a single page
+ * write. Writes that go past the end of a chip of _EEPROM_CHIP_SIZE bytes
+ * continue at the start of the chip at the next device address.
+ * 
+ * Each piece is sent as soon as the chip finishes writing the previous
+ * one, see EEPROM_wait_write(). This returns as soon as the last piece is
+ * sent so the last write cycle overlaps with whatever the caller does
+ * next.
+ * 
+ * @return The number of bytes written or -1 on failure.
+ **************************************************************************/
+
+int EEPROM_write(char *data, int size, uint16_t mem_address, char dev_address){
+    int count = 0, chunk;
+    uint32_t address = mem_address;
+
+    while(count < size){
+        chunk = _EEPROM_PAGE_SIZE - (address & (_EEPROM_PAGE_SIZE - 1));
+        if(chunk > size - count){
+            chunk = size - count;
+        }
+
+        if(EEPROM_write_page(data + count, chunk, address, dev_address) < 0){
+            return -1;
+        }
+
+        count += chunk;
+        address += chunk;
+        if(address >= _EEPROM_CHIP_SIZE){
+            address = 0;
+            dev_address++;
+        }
+    }
+    return count;
+}
+
+int __eeprom_read(uint16_t mem_address, char dev_address){
     int fval;
     char byte_out;
+    if(__eeprom_wait_write(dev_address)){
+        return -1;
+    }
+
     if(__eeprom_start()){
-        eeprom_errno |= _READ_START;
+        eeprom_errno |= EEPROM_STAGE_READ_START;
         return -1;
     }
 
     fval = __eeprom_byte_send(ADDR_WRITE(dev_address));
     if(fval == -1){
-        eeprom_errno |= _READ_CALL;
+        eeprom_errno |= EEPROM_STAGE_READ_CALL;
         return -1;
     }
     else if(fval == _NACK){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _READ_CALL;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_CALL;
         return -1;
     }
 
     fval = __eeprom_word_send((int16_t) mem_address);
     if(fval == -1){
-        eeprom_errno |= _READ_ADDR;
+        eeprom_errno |= EEPROM_STAGE_READ_ADDR;
         return -1;
     }
     else if(fval > 0){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _READ_ADDR;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_ADDR;
         return -1;
     }
 
     if(__eeprom_restart()){
-        eeprom_errno |= _READ_RSTART;
+        eeprom_errno |= EEPROM_STAGE_READ_RSTART;
         return -1;
     }
 
     fval = __eeprom_byte_send(ADDR_READ(dev_address));
     if(fval == -1){
-        eeprom_errno |= _READ_RADDR;
+        eeprom_errno |= EEPROM_STAGE_READ_RADDR;
         return -1;
     }
     else if(fval == _NACK){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _READ_RADDR;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_RADDR;
         return -1;
     }
 
     fval = __eeprom_byte_receive();
     if(fval == -1 || __eeprom_read_ack(_NACK)){
-        eeprom_errno |= _READ_NACK;
+        eeprom_errno |= EEPROM_STAGE_READ_NACK;
         return -1;
     }
 
     if(__eeprom_stop()){
-        eeprom_errno |= _READ_END;
+        eeprom_errno |= EEPROM_STAGE_READ_END;
         return -1;
     }
 
     byte_out = fval;
 
-    return byte_out;
+    // keep 0xff from being mistaken for an error
+    return (uint8_t) byte_out;
 }
 
-int EEPROM_read_delim(char *buf, int size, char *delim, uint16_t mem_address, char dev_address){
+int EEPROM_read(uint16_t mem_address, char dev_address){
+    int fval, tries = 0;
+    __eeprom_op_begin();
+    while((fval = __eeprom_read(mem_address, dev_address)) < 0){
+        if(!__eeprom_retry(&tries, 0)){
+            break;
+        }
+    }
+    __eeprom_op_end(EEPROM_OP_READ, fval);
+    return fval;
+}
+
+int __eeprom_read_begin(uint16_t mem_address, char dev_address){
+    int fval;
+    if(__eeprom_start()){
+        eeprom_errno |= EEPROM_STAGE_READ_START;
+        return -1;
+    }
+
+    fval = __eeprom_byte_send(ADDR_WRITE(dev_address));
+    if(fval == -1){
+        eeprom_errno |= EEPROM_STAGE_READ_CALL;
+        return -1;
+    }
+    else if(fval == _NACK){
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_CALL;
+        return -1;
+    }
+
+    fval = __eeprom_word_send((int16_t) mem_address);
+    if(fval == -1){
+        eeprom_errno |= EEPROM_STAGE_READ_ADDR;
+        return -1;
+    }
+    else if(fval > 0){
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_ADDR;
+        return -1;
+    }
+
+    if(__eeprom_restart()){
+        eeprom_errno |= EEPROM_STAGE_READ_RSTART;
+        return -1;
+    }
+
+    fval = __eeprom_byte_send(ADDR_READ(dev_address));
+    if(fval == -1){
+        eeprom_errno |= EEPROM_STAGE_READ_RADDR;
+        return -1;
+    }
+    else if(fval == _NACK){
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_RADDR;
+        return -1;
+    }
+    return 0;
+}
+
+int __eeprom_read_sequential(char *buf, int size, int check, uint16_t mem_address, char dev_address){
+    int fval, count = 0;
+    uint32_t end;
+
+    // the last *check* bytes are the CRC and go to eeprom_crc_frame
+    while(count < size + check){
+        if(__eeprom_wait_write(dev_address)){
+            return -1;
+        }
+        if(__eeprom_read_begin(mem_address, dev_address)){
+            return -1;
+        }
+
+        // stop at the end of the chip instead of rolling over to address 0
+        end = (uint32_t) mem_address + (size + check - count);
+        if(end > _EEPROM_CHIP_SIZE){
+            end = _EEPROM_CHIP_SIZE;
+        }
+
+        while(mem_address < end){
+            fval = __eeprom_byte_receive();
+            if(fval == -1){
+                eeprom_errno |= EEPROM_STAGE_READ_NACK;
+                return -1;
+            }
+            if(count < size){
+                buf[count] = fval;
+                if(eeprom_crc_on){
+                    __eeprom_crc_update(fval);
+                }
+            }
+            else{
+                eeprom_crc_frame = (eeprom_crc_frame << 8) | (uint8_t) fval;
+            }
+            count++;
+            mem_address++;
+            if(__eeprom_read_ack((mem_address < end) ? _ACK : _NACK)){
+                eeprom_errno |= EEPROM_STAGE_READ_NACK;
+                return -1;
+            }
+            if(mem_address == 0){
+                break;
+            }
+        }
+
+        if(__eeprom_stop()){
+            eeprom_errno |= EEPROM_STAGE_READ_END;
+            return -1;
+        }
+
+        mem_address = 0;
+        dev_address++;
+    }
+    return size;
+}
+
+int __eeprom_read_stream(char *buf, int size, int check, uint16_t mem_address, char dev_address){
+    int fval, tries = 0;
+    __eeprom_op_begin();
+    while((fval = __eeprom_read_sequential(buf, size, check, mem_address, dev_address)) < 0){
+        if(!__eeprom_retry(&tries, 0)){
+            break;
+        }
+        // the whole block is read again
+        if(eeprom_crc_on){
+            __eeprom_crc_begin();
+        }
+    }
+    __eeprom_op_end(EEPROM_OP_READ_BLOCK, fval);
+    return fval;
+}
+
+/**
+ * @param buf Buffer for the bytes read.
+ * @param size Number of bytes to read.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ * 
+ * @brief Reads a block of binary data.
+ * 
+ * Sends the address once and then reads every byte in a single
+ * sequential read, acknowledging all but the last byte. Unlike
+ * EEPROM_read_delim(), no byte value ends the read. Reads that go past
+ * the end of a chip of _EEPROM_CHIP_SIZE bytes continue at the start of
+ * the chip at the next device address with a new addressing phase.
+ * 
+ * @return The number of bytes read or -1 on failure.
+ **************************************************************************/
+
+int EEPROM_read_block(char *buf, int size, uint16_t mem_address, char dev_address){
+    return __eeprom_read_stream(buf, size, 0, mem_address, dev_address);
+}
+
+/**
+ * @param data Bytes to be written.
+ * @param size Number of bytes to write.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ * 
+ * @brief Writes a buffer followed by its CRC.
+ * 
+ * Works like EEPROM_write() and adds a CRC-16 of the data in the two
+ * bytes after it, most significant byte first, so the block takes *size*
+ * + 2 bytes. The CRC is computed while the bytes are sent and goes out in
+ * the same page write as the end of the data. The hardware CRC module is
+ * used on chips that have one.
+ * 
+ * @return The number of data bytes written or -1 on failure.
+ **************************************************************************/
+
+int EEPROM_write_crc(char *data, int size, uint16_t mem_address, char dev_address){
+    char tail[_EEPROM_PAGE_SIZE + 1];
+    uint32_t address = (uint32_t) mem_address + size;
+    uint16_t crc;
+    int head, count;
+
+    // data in the page of the first CRC byte is sent together with the CRC
+    count = address & (_EEPROM_PAGE_SIZE - 1);
+    if(count > size){
+        count = size;
+    }
+    head = size - count;
+
+    __eeprom_crc_begin();
+    if(head && EEPROM_write(data, head, mem_address, dev_address) < 0){
+        __eeprom_crc_end();
+        return -1;
+    }
+    for(count = 0; head + count < size; count++){
+        tail[count] = data[head + count];
+        __eeprom_crc_update(tail[count]);
+    }
+    crc = __eeprom_crc_end();
+    tail[count++] = crc >> 8;
+    tail[count++] = crc & 0xff;
+
+    address = (uint32_t) mem_address + head;
+    while(address >= _EEPROM_CHIP_SIZE){
+        address -= _EEPROM_CHIP_SIZE;
+        dev_address++;
+    }
+    if(EEPROM_write(tail, count, address, dev_address) < 0){
+        return -1;
+    }
+    return size;
+}
+
+/**
+ * @param buf Buffer for the bytes read.
+ * @param size Number of bytes to read, not counting the CRC.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ * 
+ * @brief Reads a block written by EEPROM_write_crc() and checks it.
+ * 
+ * The data and the CRC are read in a single sequential read, and the CRC
+ * is computed as the bytes arrive. A mismatch sets the error code to
+ * _EEPROM_CRC_MISMATCH.
+ * 
+ * @return The number of bytes read or -1 on failure or mismatch.
+ **************************************************************************/
+
+int EEPROM_read_crc(char *buf, int size, uint16_t mem_address, char dev_address){
+    int fval;
+    uint16_t crc;
+
+    __eeprom_crc_begin();
+    fval = __eeprom_read_stream(buf, size, 2, mem_address, dev_address);
+    crc = __eeprom_crc_end();
+    if(fval < 0){
+        return -1;
+    }
+    if(crc != eeprom_crc_frame){
+        eeprom_stats.crc_errors++;
+        eeprom_errno = _EEPROM_CRC_MISMATCH | EEPROM_STAGE_READ_CHECK;
+        return -1;
+    }
+    return fval;
+}
+
+/**
+ * @param data Bytes to be checked.
+ * @param size Number of bytes.
+ * 
+ * @brief Computes the CRC used by EEPROM_write_crc().
+ * 
+ * Useful to build blocks in RAM that are written with the other write
+ * functions.
+ * 
+ * @return The CRC-16 of the bytes.
+ **************************************************************************/
+
+uint16_t EEPROM_crc(char *data, int size){
+    int i;
+    __eeprom_crc_begin();
+    for(i = 0; i < size; i++){
+        __eeprom_crc_update(data[i]);
+    }
+    return __eeprom_crc_end();
+}
+
+int __eeprom_read_delim(char *buf, int size, char *delim, uint16_t mem_address, char dev_address){
     int fval, count = 0, count2;
+    if(__eeprom_wait_write(dev_address)){
+        return -1;
+    }
+
     if(__eeprom_start()){
-        eeprom_errno |= _READ_START;
+        eeprom_errno |= EEPROM_STAGE_READ_START;
         return -1;
     }
 
     fval = __eeprom_byte_send(ADDR_WRITE(dev_address));
     if(fval == -1){
-        eeprom_errno |= _READ_CALL;
+        eeprom_errno |= EEPROM_STAGE_READ_CALL;
         return -1;
     }
     else if(fval == _NACK){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _READ_CALL;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_CALL;
         return -1;
     }
 
     fval = __eeprom_word_send((int16_t) mem_address);
     if(fval == -1){
-        eeprom_errno |= _READ_ADDR;
+        eeprom_errno |= EEPROM_STAGE_READ_ADDR;
         return -1;
     }
     else if(fval > 0){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _READ_ADDR;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_ADDR;
         return -1;
     }
 
     if(__eeprom_restart()){
         if(__eeprom_stop()){
-            eeprom_errno |= _READ_RSTART;
+            eeprom_errno |= EEPROM_STAGE_READ_RSTART;
             return -1;
         }
         if(__eeprom_start()){
-            eeprom_errno |= _READ_RSTART;
+            eeprom_errno |= EEPROM_STAGE_READ_RSTART;
             return -1;
         }
     }
 
     fval = __eeprom_byte_send(ADDR_READ(dev_address));
     if(fval == -1){
-        eeprom_errno |= _READ_RADDR;
+        eeprom_errno |= EEPROM_STAGE_READ_RADDR;
         return -1;
     }
     else if(fval == _NACK){
-        eeprom_errno = _EEPROM_NOT_RESPONDING | _READ_RADDR;
+        eeprom_errno = _EEPROM_NOT_RESPONDING | EEPROM_STAGE_READ_RADDR;
         return -1;
     }
 
     while(count < size){
         fval = __eeprom_byte_receive();
         if(fval == -1){
-            _READ_NACK;
+            eeprom_errno |= EEPROM_STAGE_READ_NACK;
             return -1;
         }
         buf[count] = fval;
@@ -444,7 +1395,7 @@ int EEPROM_read_delim(char *buf, int size, char *delim, uint16_t mem_address, ch
         count++;
         if(__eeprom_read_ack((count < size && buf[count - 1] != 0) ? _ACK : _NACK)){
         //if(__eeprom_read_ack(_ACK)){
-            eeprom_errno |= _READ_NACK;
+            eeprom_errno |= EEPROM_STAGE_READ_NACK;
             return -1;
         }
         if(!buf[count-1]){
@@ -454,33 +1405,211 @@ int EEPROM_read_delim(char *buf, int size, char *delim, uint16_t mem_address, ch
     }
 
     if(__eeprom_stop()){
-        eeprom_errno |= _READ_END;
+        eeprom_errno |= EEPROM_STAGE_READ_END;
         return -1;
     }
 
     return count;
 }
 
-int EEPROM_isPresent(char dev_address){
+int EEPROM_read_delim(char *buf, int size, char *delim, uint16_t mem_address, char dev_address){
+    int fval, tries = 0;
+    __eeprom_op_begin();
+    while((fval = __eeprom_read_delim(buf, size, delim, mem_address, dev_address)) < 0){
+        if(!__eeprom_retry(&tries, 0)){
+            break;
+        }
+    }
+    __eeprom_op_end(EEPROM_OP_READ_DELIM, fval);
+    return fval;
+}
+
+int __eeprom_is_present(char dev_address){
     char retval; 
+#if _I2C_SOFTWARE != 1
     _EEPROM_STAT.BCL = 0;
+#endif
     if(__eeprom_start()){
-        eeprom_errno |= _POLL_START;
+        eeprom_errno |= EEPROM_STAGE_POLL_START;
         return -1;
     }
 
     retval = __eeprom_byte_send(ADDR_WRITE(dev_address));
     if(retval == -1){
-        eeprom_errno |= _POLL_SEND;
+        eeprom_errno |= EEPROM_STAGE_POLL_SEND;
         return -1;
     }
     
     if(__eeprom_stop()){
-        eeprom_errno |= _POLL_STOP;
+        eeprom_errno |= EEPROM_STAGE_POLL_STOP;
         return -1;
     }
     
     return !retval;
 }
 
+int EEPROM_isPresent(char dev_address){
+    int fval, tries = 0;
+    __eeprom_op_begin();
+    while((fval = __eeprom_is_present(dev_address)) < 0){
+        if(!__eeprom_retry(&tries, 0)){
+            break;
+        }
+    }
+    __eeprom_op_end(EEPROM_OP_POLL, fval);
+    return fval;
+}
+
+int __eeprom_wait_write(char dev_address){
+    int fval;
+    uint32_t count;
+
+    if(!(eeprom_pending & (1 << dev_address))){
+        return 0;
+    }
+
+    if(__eeprom_start()){
+        eeprom_errno |= EEPROM_STAGE_POLL_START;
+        return -1;
+    }
+
+    for(count = 0; count < __EEPROM_POLL_LIMIT; count++){
+        fval = __eeprom_byte_send(ADDR_WRITE(dev_address));
+        if(fval == -1){
+            eeprom_errno |= EEPROM_STAGE_POLL_SEND;
+            return -1;
+        }
+        else if(fval == _ACK){
+            eeprom_pending &= ~(1 << dev_address);
+            if(__eeprom_stop()){
+                eeprom_errno |= EEPROM_STAGE_POLL_STOP;
+                return -1;
+            }
+            return 0;
+        }
+
+        if(__eeprom_restart()){
+            eeprom_errno |= EEPROM_STAGE_POLL_START;
+            return -1;
+        }
+    }
+
+    __eeprom_stop();
+    eeprom_errno = _EEPROM_WRITE_TIMEOUT | EEPROM_STAGE_POLL_SEND;
+    return -1;
+}
+
+/**
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ * 
+ * @brief Waits for the chip to finish its write cycle.
+ * 
+ * After a write, the chip ignores the bus until the data is programmed,
+ * which takes up to 5ms. This sends the control byte of the chip with
+ * repeated starts until it is acknowledged, so the wait is only as long
+ * as the chip really needs. Returns immediately if no write was done to
+ * the chip since the last wait.
+ * 
+ * This is called by every read and write function before they start so
+ * there is no need to call it between them.
+ * 
+ * @return 0 once the chip is ready or -1 on failure or if the chip is
+ * still busy after _EEPROM_WRITE_TIMEOUT_US microseconds.
+ **************************************************************************/
+
+int EEPROM_wait_write(char dev_address){
+    int fval, tries = 0;
+    __eeprom_op_begin();
+    while((fval = __eeprom_wait_write(dev_address)) < 0){
+        if(!__eeprom_retry(&tries, 0)){
+            break;
+        }
+    }
+    __eeprom_op_end(EEPROM_OP_POLL, fval);
+    return fval;
+}
+
+/**
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ * 
+ * @brief Checks if the chip finished its write cycle without waiting.
+ * 
+ * Sends the control byte of the chip once if a write is pending. Useful
+ * to do other work while the chip is busy instead of calling
+ * EEPROM_wait_write().
+ * 
+ * @return 1 if the chip is ready, 0 if it is still writing or -1 on
+ * failure.
+ **************************************************************************/
+
+int EEPROM_write_done(char dev_address){
+    int fval;
+
+    if(!(eeprom_pending & (1 << dev_address))){
+        return 1;
+    }
+
+    fval = EEPROM_isPresent(dev_address);
+    if(fval == 1){
+        eeprom_pending &= ~(1 << dev_address);
+    }
+    return fval;
+}
+
+/**
+ * @brief Keeps track of the write cycles without waiting.
+ * 
+ * Polls one of the chips still in their write cycle once, taking the
+ * chips in turn over successive calls. Meant to be called from a periodic
+ * task of the scheduler library, after which EEPROM_write() and the other
+ * write functions find the chips ready instead of polling them in a loop.
+ * 
+ * With the interrupt driven I2C library, the poll is queued with
+ * i2c_submit() and this returns at once. The chip is marked ready from
+ * the interrupt once it acknowledges, and no new poll is queued while the
+ * previous one is still waiting. Without it, each call polls with
+ * EEPROM_write_done() and blocks for a start, the control byte and a
+ * stop, about 28us at 400kHz, or up to about 0.6ms per try on a stuck
+ * bus as described in toolbox_settings.h.
+ * 
+ * @return A mask of the chips still in their write cycle, with bit n set
+ * for the chip at address n, or 0 if none.
+ **************************************************************************/
+
+#if __LIBI2C_ASYNC_DISABLE != 1
+void __eeprom_service_done(i2c_txn_t *txn){
+    if(txn->status == I2C_DONE){
+        eeprom_pending &= ~(1 << (txn->address & 7));
+    }
+}
+#endif
+
+int EEPROM_service(){
+    uint8_t i;
+
+    if(!eeprom_pending){
+        return 0;
+    }
+#if __LIBI2C_ASYNC_DISABLE != 1
+    if(eeprom_service_txn.status == I2C_PENDING
+            || eeprom_service_txn.status == I2C_BUSY){
+        return eeprom_pending;
+    }
+#endif
+    for(i = 0; i < 8; i++){
+        eeprom_service_dev = (eeprom_service_dev + 1) & 7;
+        if(eeprom_pending & (1 << eeprom_service_dev)){
+#if __LIBI2C_ASYNC_DISABLE != 1
+            i2c_eeprom_poll(&eeprom_service_txn, eeprom_service_dev);
+            eeprom_service_txn.done = __eeprom_service_done;
+            i2c_submit(&eeprom_service_txn);
+#else
+            EEPROM_write_done(eeprom_service_dev);
+#endif
+            break;
+        }
+    }
+    return eeprom_pending;
+}
+
 #endif
\ No newline at end of file
@@ -19,14 +19,146 @@
 #define _EEPROM_READ_BUF_OVERFLOW 4
 #define _EEPROM_READ_TIMEOUT 5
 #define _EEPROM_BUS_RESTARTED 6
+#define _EEPROM_WRITE_TIMEOUT 7
+#define _EEPROM_CRC_MISMATCH 8
+#define _EEPROM_BUS_TIMEOUT 9
 #define _EEPROM_FATAL_ERROR 0xff
 
+/**
+ * @def EEPROM_STAGE_START1
+ *
+ * @brief Stage codes found in the upper bits of the error value.
+ *
+ * The EEPROM_STAGE_* values from 0x100 to 0x700 name the bus primitive
+ * that failed and are also the stages given to EEPROM_wait_peak(). The
+ * values from 0x10000 up name the step of the operation that failed.
+ **************************************************************************/
+#define EEPROM_STAGE_START1 0x100
+#define EEPROM_STAGE_START2 0x200
+#define EEPROM_STAGE_RSTART 0x300
+#define EEPROM_STAGE_SEND 0x400
+#define EEPROM_STAGE_STOP 0x500
+#define EEPROM_STAGE_SENDACK 0x600
+#define EEPROM_STAGE_RECEIVE 0x700
+#define EEPROM_STAGE_WSEND1 0x1000
+#define EEPROM_STAGE_WSEND2 0x2000
+#define EEPROM_STAGE_WRITE_START 0x10000
+#define EEPROM_STAGE_WRITE_CALL 0x20000
+#define EEPROM_STAGE_WRITE_ADDR 0x30000
+#define EEPROM_STAGE_WRITE_SEND 0x40000
+#define EEPROM_STAGE_WRITE_STOP 0x50000
+#define EEPROM_STAGE_READ_START 0x60000
+#define EEPROM_STAGE_READ_CALL 0x70000
+#define EEPROM_STAGE_READ_ADDR 0x80000
+#define EEPROM_STAGE_READ_RSTART 0x90000
+#define EEPROM_STAGE_READ_RADDR 0xA0000
+#define EEPROM_STAGE_READ_NACK 0xB0000
+#define EEPROM_STAGE_READ_END 0xC0000
+#define EEPROM_STAGE_POLL_START 0xD0000
+#define EEPROM_STAGE_POLL_SEND 0xE0000
+#define EEPROM_STAGE_POLL_STOP 0xF0000
+#define EEPROM_STAGE_READ_CHECK 0x100000
+
+extern const uint32_t eeprom_scl_hz;
+extern const uint32_t eeprom_byte_rate;
+
+/**
+ * @def EEPROM_OP_READ
+ *
+ * @brief Index of EEPROM_read() in the statistics.
+ *
+ * @def EEPROM_OP_READ_BLOCK
+ *
+ * @brief Index of EEPROM_read_block() and EEPROM_read_crc().
+ *
+ * @def EEPROM_OP_READ_DELIM
+ *
+ * @brief Index of EEPROM_read_delim() and EEPROM_read_string().
+ *
+ * @def EEPROM_OP_WRITE_BYTE
+ *
+ * @brief Index of EEPROM_write_byte().
+ *
+ * @def EEPROM_OP_WRITE_PAGE
+ *
+ * @brief Index of EEPROM_write_page(), also used by EEPROM_write().
+ *
+ * @def EEPROM_OP_POLL
+ *
+ * @brief Index of EEPROM_isPresent() and EEPROM_wait_write().
+ *
+ * @def EEPROM_BUCKETS
+ *
+ * @brief Number of latency buckets of each operation.
+ **************************************************************************/
+#define EEPROM_OP_READ 0
+#define EEPROM_OP_READ_BLOCK 1
+#define EEPROM_OP_READ_DELIM 2
+#define EEPROM_OP_WRITE_BYTE 3
+#define EEPROM_OP_WRITE_PAGE 4
+#define EEPROM_OP_POLL 5
+#define EEPROM_OPS 6
+#define EEPROM_BUCKETS 8
+
+/**
+ * @brief Error and statistics block of the EEPROM library.
+ *
+ * The latency of every operation is measured in iterations of the loops
+ * waiting on the bus, summed over the whole operation including retries,
+ * and each iteration takes 3 to 6 instruction cycles. Bucket 0 counts
+ * operations under 64 iterations and every following bucket covers 4
+ * times more, with the last one holding everything above. Page writes by
+ * EEPROM_write_page_async() wait without looping, so they are counted in
+ * *operations* but not in the histograms.
+ **************************************************************************/
+typedef struct {
+    uint32_t operations[EEPROM_OPS]; ///< Operations done of each kind.
+    uint32_t failures;      ///< Operations that returned an error.
+    uint32_t nacks;         ///< Failures from a chip not acknowledging.
+    uint32_t collisions;    ///< Failures from bus collisions.
+    uint32_t timeouts;      ///< Waits on the bus that timed out.
+    uint32_t recoveries;    ///< Attempts to free a stuck bus.
+    uint32_t retries;       ///< Operations tried again after a timeout.
+    uint32_t crc_errors;    ///< CRC mismatches in EEPROM_read_crc().
+    uint32_t bytes_sent;    ///< Bytes sent including control bytes.
+    uint32_t bytes_received; ///< Bytes received.
+    uint32_t last_error;    ///< Value of the error of the last failure.
+    uint8_t last_operation; ///< Operation of the last failure.
+    uint16_t latency[EEPROM_OPS][EEPROM_BUCKETS]; ///< Latency histograms.
+} eeprom_stats_t;
+
+/**
+ * @brief State of a coroutine of the EEPROM library.
+ *
+ * Passed to EEPROM_write_page_async(), which keeps its retries and its
+ * outcome here between calls.
+ **************************************************************************/
+typedef struct {
+    tb_thread_t thread;     ///< State of the coroutine.
+    int tries;              ///< Retries done so far.
+    int result;             ///< Outcome once the coroutine is done.
+} eeprom_async_t;
+
 void EEPROM_begin();
 short unsigned int EEPROM_error();
 short unsigned int EEPROM_error2();
+short unsigned int EEPROM_error3();
+const eeprom_stats_t *EEPROM_stats();
+void EEPROM_stats_clear();
 int EEPROM_isPresent(char dev_address);
+int EEPROM_wait_write(char dev_address);
+uint16_t EEPROM_wait_peak(uint32_t stage);
+int EEPROM_write_done(char dev_address);
+int EEPROM_service();
+int EEPROM_write_byte(char data, uint16_t mem_address, char dev_address);
 int EEPROM_write_page(char *data, int size, uint16_t mem_address, char dev_address);
+int EEPROM_write_page_async(eeprom_async_t *op, char *data, int size, uint16_t mem_address, char dev_address);
+int EEPROM_write(char *data, int size, uint16_t mem_address, char dev_address);
 int EEPROM_read(uint16_t mem_address, char dev_address);
+int EEPROM_read_block(char *buf, int size, uint16_t mem_address, char dev_address);
+int EEPROM_write_crc(char *data, int size, uint16_t mem_address, char dev_address);
+int EEPROM_read_crc(char *buf, int size, uint16_t mem_address, char dev_address);
+uint16_t EEPROM_crc(char *data, int size);
 int EEPROM_read_delim(char *buf, int size, char *delim, uint16_t mem_address, char dev_address);
 
 #define EEPROM_read_string(buf, size, mem_address, dev_address) EEPROM_read_delim(buf, size, "", mem_address, dev_address)
@@ -0,0 +1,257 @@
+/**
+ * @file  eeprom_cache.c
+ * @brief This file contains function wrappers for cached EEPROM access
+ * @author Jaime Bronozo
+ *
+ * This is a library that keeps recently used EEPROM pages in RAM. Reads
+ * of cached pages do not touch the bus and writes only modify the cached
+ * copy, so several writes to the same page are programmed into the chip
+ * with a single page write once the page is evicted or EEPROM_flush() is
+ * called. Pages are replaced in least recently used order. The number of
+ * cached pages is set by _EEPROM_CACHE_PAGES in toolbox_settings.h.
+ *
+ * @note Data written through the cache is not in the chip until it is
+ * flushed. Mixing cached and direct writes to the same pages must be
+ * avoided, or the cache must be flushed and invalidated in between.
+ *
+ * @date December 6, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBEEPROM_I2C_SETTINGS
+#define __LIBEEPROM_CACHE_SETTINGS
+
+#include "toolbox_settings.h"
+#include "eeprom.h"
+#include "eeprom_cache.h"
+
+#if __LIBEEPROM_CACHE_DISABLE != 1
+
+#if __LIBEEPROM_I2C_DISABLE == 1
+#error "eeprom_cache.c requires the eeprom library to be enabled"
+#endif
+
+#define _PAGE_MASK ((uint16_t) (_EEPROM_PAGE_SIZE - 1))
+/// @endcond
+
+/**
+ * @brief A cached page.
+ *
+ * Internal structure holding the copy of a page and the range of bytes
+ * that were changed since it was last written to the chip.
+ **************************************************************************/
+typedef struct {
+    uint8_t valid;
+    uint8_t dirty;
+    char dev_address;
+    uint16_t page;
+    uint16_t dirty_low;
+    uint16_t dirty_high;
+    uint16_t used;
+    char data[_EEPROM_PAGE_SIZE];
+} eeprom_line_t;
+
+eeprom_line_t eeprom_cache[_EEPROM_CACHE_PAGES];
+uint16_t eeprom_cache_clock = 0;
+uint32_t eeprom_cache_hit = 0;
+uint32_t eeprom_cache_miss = 0;
+
+int __eeprom_cache_clean(eeprom_line_t *line){
+    if(!line->valid || !line->dirty){
+        return 0;
+    }
+    if(EEPROM_write_page(line->data + line->dirty_low,
+            line->dirty_high - line->dirty_low,
+            line->page + line->dirty_low, line->dev_address) < 0){
+        return -1;
+    }
+    line->dirty = 0;
+    return 0;
+}
+
+eeprom_line_t *__eeprom_cache_find(uint16_t page, char dev_address, int fill){
+    eeprom_line_t *line, *victim = &eeprom_cache[0];
+    int i;
+
+    for(i = 0; i < _EEPROM_CACHE_PAGES; i++){
+        line = &eeprom_cache[i];
+        if(line->valid && line->page == page && line->dev_address == dev_address){
+            eeprom_cache_hit++;
+            line->used = ++eeprom_cache_clock;
+            return line;
+        }
+        // empty lines first, then the least recently used one
+        if(victim->valid && (!line->valid ||
+                (uint16_t) (eeprom_cache_clock - line->used) >
+                (uint16_t) (eeprom_cache_clock - victim->used))){
+            victim = line;
+        }
+    }
+
+    eeprom_cache_miss++;
+    if(__eeprom_cache_clean(victim)){
+        return 0;
+    }
+    victim->valid = 0;
+    if(fill && EEPROM_read_block(victim->data, _EEPROM_PAGE_SIZE, page, dev_address) < 0){
+        return 0;
+    }
+    victim->valid = 1;
+    victim->dirty = 0;
+    victim->page = page;
+    victim->dev_address = dev_address;
+    victim->used = ++eeprom_cache_clock;
+    return victim;
+}
+
+/**
+ * @param buf Buffer for the bytes read.
+ * @param size Number of bytes to read.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ *
+ * @brief Reads bytes through the cache.
+ *
+ * Pages that are not cached are read in full and kept, evicting the
+ * least recently used page. Reads past the end of a chip continue on the
+ * next device address.
+ *
+ * @return The number of bytes read or -1 on failure.
+ **************************************************************************/
+
+int EEPROM_cache_read(char *buf, int size, uint16_t mem_address, char dev_address){
+    eeprom_line_t *line;
+    uint32_t address = mem_address;
+    uint16_t offset;
+    int count = 0;
+
+    while(count < size){
+        line = __eeprom_cache_find(address & ~_PAGE_MASK, dev_address, 1);
+        if(!line){
+            return -1;
+        }
+        offset = address & _PAGE_MASK;
+        while(offset < _EEPROM_PAGE_SIZE && count < size){
+            buf[count++] = line->data[offset++];
+        }
+
+        address = (address & ~(uint32_t) _PAGE_MASK) + _EEPROM_PAGE_SIZE;
+        if(address >= _EEPROM_CHIP_SIZE){
+            address = 0;
+            dev_address++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @param data Bytes to be written.
+ * @param size Number of bytes to write.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ *
+ * @brief Writes bytes through the cache.
+ *
+ * Only the cached copy of the page is changed. Pages that are not cached
+ * are read first unless they are completely overwritten. Writes past the
+ * end of a chip continue on the next device address.
+ *
+ * @return The number of bytes written or -1 on failure.
+ **************************************************************************/
+
+int EEPROM_cache_write(char *data, int size, uint16_t mem_address, char dev_address){
+    eeprom_line_t *line;
+    uint32_t address = mem_address;
+    uint16_t offset, first;
+    int count = 0;
+
+    while(count < size){
+        first = offset = address & _PAGE_MASK;
+        line = __eeprom_cache_find(address & ~_PAGE_MASK, dev_address,
+                offset != 0 || size - count < _EEPROM_PAGE_SIZE);
+        if(!line){
+            return -1;
+        }
+        while(offset < _EEPROM_PAGE_SIZE && count < size){
+            line->data[offset++] = data[count++];
+        }
+
+        if(!line->dirty){
+            line->dirty = 1;
+            line->dirty_low = first;
+            line->dirty_high = offset;
+        }
+        else{
+            if(first < line->dirty_low){
+                line->dirty_low = first;
+            }
+            if(offset > line->dirty_high){
+                line->dirty_high = offset;
+            }
+        }
+
+        address = (address & ~(uint32_t) _PAGE_MASK) + _EEPROM_PAGE_SIZE;
+        if(address >= _EEPROM_CHIP_SIZE){
+            address = 0;
+            dev_address++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Writes every changed page to the chips.
+ *
+ * Each changed page is programmed with a single page write covering the
+ * changed bytes. The pages stay cached.
+ *
+ * @return 0 on success or -1 if a write failed.
+ **************************************************************************/
+
+int EEPROM_flush(){
+    int i, fval = 0;
+    for(i = 0; i < _EEPROM_CACHE_PAGES; i++){
+        if(__eeprom_cache_clean(&eeprom_cache[i])){
+            fval = -1;
+        }
+    }
+    return fval;
+}
+
+/**
+ * @brief Drops every cached page.
+ *
+ * Changes that were not flushed are lost.
+ *
+ * @return none
+ **************************************************************************/
+
+void EEPROM_cache_invalidate(){
+    int i;
+    for(i = 0; i < _EEPROM_CACHE_PAGES; i++){
+        eeprom_cache[i].valid = 0;
+        eeprom_cache[i].dirty = 0;
+    }
+}
+
+/**
+ * @brief Gives the number of page lookups found in the cache.
+ *
+ * @return The number of hits since the start of the program.
+ **************************************************************************/
+
+uint32_t EEPROM_cache_hits(){
+    return eeprom_cache_hit;
+}
+
+/**
+ * @brief Gives the number of page lookups that needed the chip.
+ *
+ * @return The number of misses since the start of the program.
+ **************************************************************************/
+
+uint32_t EEPROM_cache_misses(){
+    return eeprom_cache_miss;
+}
+
+#endif
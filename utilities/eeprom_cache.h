@@ -0,0 +1,23 @@
+/**
+ * @file  eeprom_cache.h
+ * @brief This file contains function wrappers for cached EEPROM access
+ * @author Jaime Bronozo
+ *
+ * This is a header file for eeprom_cache.c which must be included to any
+ * source files that require cached access to EEPROM chips. This library
+ * is dynamically included in the main header PIC24_toolbox.h
+ *
+ * @date December 6, 2018
+ **************************************************************************/
+
+#ifndef __EEPROM_CACHE_TOOLBOX_H__
+#define __EEPROM_CACHE_TOOLBOX_H__
+
+int EEPROM_cache_read(char *buf, int size, uint16_t mem_address, char dev_address);
+int EEPROM_cache_write(char *data, int size, uint16_t mem_address, char dev_address);
+int EEPROM_flush();
+void EEPROM_cache_invalidate();
+uint32_t EEPROM_cache_hits();
+uint32_t EEPROM_cache_misses();
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * @file  estream.c
+ * @brief This file contains function wrappers for EEPROM streams
+ * @author Jaime Bronozo
+ *
+ * This is a library that presents up to eight EEPROM chips as a single
+ * linear memory read and written as a stream. The position of a stream
+ * moves forward with every read and write and can be moved with
+ * estream_seek(). Small reads are served from a read-ahead buffer filled
+ * with a single sequential read of _ESTREAM_BUFFER bytes, and reads at
+ * least as large as the buffer go straight to the caller in a single
+ * sequential read, so reading through a stream in small pieces does not
+ * cost one bus transaction per call.
+ *
+ * @date December 11, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBEEPROM_I2C_SETTINGS
+#define __LIBESTREAM_SETTINGS
+
+#include "toolbox_settings.h"
+#include "eeprom.h"
+#include "estream.h"
+
+#if __LIBESTREAM_DISABLE != 1
+
+#if __LIBEEPROM_I2C_DISABLE == 1
+#error "estream.c requires the eeprom library to be enabled"
+#endif
+
+#if _ESTREAM_CHIPS < 1 || _ESTREAM_CHIPS > 8
+#error "_ESTREAM_CHIPS must be from 1 to 8"
+#endif
+/// @endcond
+
+/**
+ * @brief Size of the linear memory.
+ *
+ * Number of bytes in all the chips together, which is also the highest
+ * position a stream can reach.
+ **************************************************************************/
+const uint32_t estream_size = _ESTREAM_CHIPS * _EEPROM_CHIP_SIZE;
+
+int __estream_read(char *buf, int size, uint32_t address){
+    return EEPROM_read_block(buf, size, address % _EEPROM_CHIP_SIZE,
+            address / _EEPROM_CHIP_SIZE);
+}
+
+/**
+ * @param stream Stream to be set up.
+ *
+ * @brief Sets up a stream at linear address 0.
+ *
+ * @return none
+ **************************************************************************/
+
+void estream_open(estream_t *stream){
+    stream->position = 0;
+    stream->start = 0;
+    stream->length = 0;
+}
+
+/**
+ * @param stream Stream to be moved.
+ * @param offset Number of bytes to move by.
+ * @param whence #ESTREAM_SET, #ESTREAM_CUR or #ESTREAM_END.
+ *
+ * @brief Moves the position of a stream.
+ *
+ * The buffered bytes are kept so moving back and forth within the
+ * buffer does not read the chips again.
+ *
+ * @return The new position or -1 if it would be outside the linear
+ * memory.
+ **************************************************************************/
+
+int32_t estream_seek(estream_t *stream, int32_t offset, int whence){
+    int32_t position;
+
+    switch(whence){
+        case ESTREAM_SET:
+            position = offset;
+            break;
+        case ESTREAM_CUR:
+            position = stream->position + offset;
+            break;
+        case ESTREAM_END:
+            position = estream_size + offset;
+            break;
+        default:
+            return -1;
+    }
+
+    if(position < 0 || (uint32_t) position > estream_size){
+        return -1;
+    }
+    stream->position = position;
+    return position;
+}
+
+/**
+ * @param stream Stream to be checked.
+ *
+ * @brief Gives the position of a stream.
+ *
+ * @return The linear address of the next byte read or written.
+ **************************************************************************/
+
+uint32_t estream_tell(estream_t *stream){
+    return stream->position;
+}
+
+/**
+ * @param stream Stream to read from.
+ * @param buf Buffer for the bytes read.
+ * @param size Number of bytes to read.
+ *
+ * @brief Reads bytes from the position of a stream.
+ *
+ * Bytes found in the buffer are copied from it. The rest is read with a
+ * single sequential read, straight into *buf* if it is at least as large
+ * as the buffer or through the buffer otherwise, reading ahead of the
+ * position. Reads stop at the end of the linear memory.
+ *
+ * @return The number of bytes read, 0 at the end of the linear memory or
+ * -1 on failure.
+ **************************************************************************/
+
+int estream_read(estream_t *stream, void *buf, int size){
+    char *out = buf;
+    uint32_t offset;
+    int count = 0, chunk;
+
+    // a negative size would otherwise convert to the whole rest of the memory
+    if(size > 0 && (uint32_t) size > estream_size - stream->position){
+        size = estream_size - stream->position;
+    }
+
+    while(count < size){
+        offset = stream->position - stream->start;
+        if(stream->position >= stream->start && offset < stream->length){
+            chunk = stream->length - offset;
+            if(chunk > size - count){
+                chunk = size - count;
+            }
+            while(chunk--){
+                out[count++] = stream->buffer[offset++];
+                stream->position++;
+            }
+            continue;
+        }
+
+        chunk = size - count;
+        if(chunk >= _ESTREAM_BUFFER){
+            if(__estream_read(out + count, chunk, stream->position) < 0){
+                return -1;
+            }
+            count += chunk;
+            stream->position += chunk;
+            continue;
+        }
+
+        chunk = _ESTREAM_BUFFER;
+        if((uint32_t) chunk > estream_size - stream->position){
+            chunk = estream_size - stream->position;
+        }
+        stream->length = 0;
+        if(__estream_read(stream->buffer, chunk, stream->position) < 0){
+            return -1;
+        }
+        stream->start = stream->position;
+        stream->length = chunk;
+    }
+    return count;
+}
+
+/**
+ * @param stream Stream to write to.
+ * @param data Bytes to be written.
+ * @param size Number of bytes to write.
+ *
+ * @brief Writes bytes at the position of a stream.
+ *
+ * The bytes are written with EEPROM_write() so page and chip boundaries
+ * are handled, and buffered bytes that are overwritten are updated.
+ * Writes stop at the end of the linear memory.
+ *
+ * @return The number of bytes written, 0 at the end of the linear memory
+ * or -1 on failure.
+ **************************************************************************/
+
+int estream_write(estream_t *stream, void *data, int size){
+    char *in = data;
+    uint32_t address;
+    int i;
+
+    if(size > 0 && (uint32_t) size > estream_size - stream->position){
+        size = estream_size - stream->position;
+    }
+    if(size <= 0){
+        return 0;
+    }
+    if(EEPROM_write(in, size, stream->position % _EEPROM_CHIP_SIZE,
+            stream->position / _EEPROM_CHIP_SIZE) < 0){
+        return -1;
+    }
+
+    for(i = 0; i < size; i++){
+        address = stream->position + i;
+        if(address >= stream->start && address - stream->start < stream->length){
+            stream->buffer[address - stream->start] = in[i];
+        }
+    }
+    stream->position += size;
+    return size;
+}
+
+/**
+ * @param stream Stream to read from.
+ *
+ * @brief Reads a single byte from the position of a stream.
+ *
+ * @return The byte read, or -1 at the end of the linear memory or on
+ * failure.
+ **************************************************************************/
+
+int estream_getc(estream_t *stream){
+    uint8_t byte;
+    if(estream_read(stream, &byte, 1) != 1){
+        return -1;
+    }
+    return byte;
+}
+
+/**
+ * @param stream Stream to be cleared.
+ *
+ * @brief Empties the read-ahead buffer of a stream.
+ *
+ * Must be called when the chips were written without going through this
+ * stream so that the next read does not give stale bytes.
+ *
+ * @return none
+ **************************************************************************/
+
+void estream_drop(estream_t *stream){
+    stream->length = 0;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file  estream.h
+ * @brief This file contains function wrappers for EEPROM streams
+ * @author Jaime Bronozo
+ *
+ * This is a header file for estream.c which must be included to any
+ * source files that require access to the EEPROM chips as a single
+ * linear memory. This library is dynamically included in the main header
+ * PIC24_toolbox.h
+ *
+ * @date December 11, 2018
+ **************************************************************************/
+
+#ifndef __ESTREAM_TOOLBOX_H__
+#define __ESTREAM_TOOLBOX_H__
+
+/**
+ * @def ESTREAM_SET
+ *
+ * @brief Seek relative to the start of the linear memory.
+ *
+ * @def ESTREAM_CUR
+ *
+ * @brief Seek relative to the current position.
+ *
+ * @def ESTREAM_END
+ *
+ * @brief Seek relative to the end of the linear memory.
+ **************************************************************************/
+#define ESTREAM_SET 0
+#define ESTREAM_CUR 1
+#define ESTREAM_END 2
+
+/**
+ * @brief Stream over the linear memory of all the EEPROM chips.
+ *
+ * Linear address 0 is address 0 of the chip at device address 0, and
+ * each following chip continues where the previous one ends. Set up with
+ * estream_open(). The fields are maintained by the library.
+ **************************************************************************/
+typedef struct {
+    uint32_t position;  ///< Linear address of the next byte.
+    uint32_t start;     ///< Linear address of the first buffered byte.
+    uint16_t length;    ///< Number of bytes in *buffer*.
+    char buffer[_ESTREAM_BUFFER];
+} estream_t;
+
+extern const uint32_t estream_size;
+
+void estream_open(estream_t *stream);
+int32_t estream_seek(estream_t *stream, int32_t offset, int whence);
+uint32_t estream_tell(estream_t *stream);
+int estream_read(estream_t *stream, void *buf, int size);
+int estream_write(estream_t *stream, void *data, int size);
+int estream_getc(estream_t *stream);
+void estream_drop(estream_t *stream);
+
+#endif
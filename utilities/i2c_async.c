@@ -0,0 +1,515 @@
+/**
+ * @file  i2c_async.c
+ * @brief This file contains function wrappers for interrupt driven I2C
+ * @author Jaime Bronozo
+ *
+ * This is a library for running I2C transactions in the background using
+ * the master interrupt of the I2C module selected for the EEPROM library.
+ * Each transaction is described by an #i2c_txn_t which is queued with
+ * i2c_submit() and stepped through by the interrupt one bus event at a
+ * time, so the CPU is free while the bus is busy. Completion is reported
+ * through the status of the descriptor and an optional callback.
+ *
+ * @note The bus must be set up with EEPROM_begin() first. The blocking
+ * functions of eeprom.c wait for the queue to drain before using the bus
+ * but must not be called from a context that can interrupt a blocking
+ * transaction in progress.
+ *
+ * @date December 3, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBEEPROM_I2C_SETTINGS
+#define __LIBI2C_ASYNC_SETTINGS
+
+#include "toolbox_settings.h"
+#include "eeprom.h"
+#include "i2c_async.h"
+
+#if __LIBI2C_ASYNC_DISABLE != 1
+
+#if __LIBEEPROM_I2C_DISABLE == 1
+#error "i2c_async.c requires the eeprom library to be enabled"
+#endif
+
+#define _I2C_STAT __I2C_STAT(_I2C_NUM)
+#define _I2C_CON __I2C_CON(_I2C_NUM)
+#define _I2C_TRN __I2C_TRN(_I2C_NUM)
+#define _I2C_RCV __I2C_RCV(_I2C_NUM)
+#define _I2C_IF __I2C_IF(_I2C_NUM)
+#define _I2C_IE __I2C_IE(_I2C_NUM)
+#define _I2C_IP __I2C_IP(_I2C_NUM)
+
+#define _S_START 0
+#define _S_ADDR_W 1
+#define _S_WRITE 2
+#define _S_RSTART 3
+#define _S_ADDR_R 4
+#define _S_READ 5
+#define _S_ACK 6
+#define _S_STOP 7
+/// @endcond
+
+/**
+ * @brief Stage codes reported for errors in each state.
+ *
+ * Maps the states of the transaction to the stage codes used by
+ * eeprom_errno so errors read the same for both libraries.
+ **************************************************************************/
+static const uint32_t i2c_stage[] = {
+    EEPROM_STAGE_WRITE_START, EEPROM_STAGE_WRITE_CALL,
+    EEPROM_STAGE_WRITE_SEND, EEPROM_STAGE_READ_RSTART,
+    EEPROM_STAGE_READ_RADDR, EEPROM_STAGE_READ_NACK,
+    EEPROM_STAGE_READ_NACK, EEPROM_STAGE_WRITE_STOP
+};
+
+extern uint8_t eeprom_pending;
+
+i2c_txn_t *volatile i2c_head = 0;
+i2c_txn_t *i2c_rx = 0;
+uint16_t i2c_rx_left = 0;
+uint16_t i2c_merge_count = 0;
+uint32_t i2c_error = 0;
+
+void __i2c_begin(i2c_txn_t *txn){
+    i2c_txn_t *item;
+
+    txn->state = _S_START;
+    txn->count = 0;
+    i2c_error = 0;
+    i2c_rx = txn;
+    i2c_rx_left = 0;
+    for(item = txn; item; item = item->merged){
+        item->status = I2C_BUSY;
+        i2c_rx_left += item->read_size;
+    }
+
+    _I2C_STAT.BCL = 0;
+    _I2C_STAT.IWCOL = 0;
+    _I2C_IF = 0;
+    _I2C_IE = 1;
+    _I2C_CON.SEN = 1;
+}
+
+void __i2c_finish(i2c_txn_t *txn){
+    i2c_txn_t *item, *merged;
+    i2c_head = txn->next;
+
+    // merged reads complete together with the one that carried them
+    for(item = txn; item; item = merged){
+        merged = item->merged;
+        item->merged = 0;
+        item->next = 0;
+        item->error = i2c_error;
+        if(!i2c_error && (item->flags & I2C_EEPROM_WRITE)){
+            eeprom_pending |= 1 << (item->address & 7);
+        }
+        item->status = i2c_error ? I2C_ERROR : I2C_DONE;
+        if(item->done){
+            item->done(item);
+        }
+    }
+
+    if(i2c_head){
+        __i2c_begin(i2c_head);
+    }
+    else{
+        _I2C_IE = 0;
+    }
+}
+
+void __i2c_fail(i2c_txn_t *txn, uint32_t code){
+    i2c_error = code | i2c_stage[txn->state];
+    txn->state = _S_STOP;
+    _I2C_CON.PEN = 1;
+}
+
+void __i2c_send_next(i2c_txn_t *txn){
+    uint16_t total = txn->prefix_size + txn->write_size;
+
+    if(txn->count < total){
+        txn->state = _S_WRITE;
+        _I2C_TRN = (txn->count < txn->prefix_size) ?
+                txn->prefix[txn->count] :
+                txn->write[txn->count - txn->prefix_size];
+        txn->count++;
+    }
+    else if(i2c_rx_left){
+        // counts the reads merged behind this one too
+        txn->state = _S_RSTART;
+        _I2C_CON.RSEN = 1;
+    }
+    else{
+        txn->state = _S_STOP;
+        _I2C_CON.PEN = 1;
+    }
+}
+
+/**
+ * @fn void i2c_update()
+ * @brief Advances the transaction on the bus by one step.
+ *
+ * This function must be called inside the master I2C interrupt when
+ * __LIBI2C_ASYNC_ISR is set to 0. This allows the library to coexist with
+ * code that requires the use of the interrupt.
+ *
+ * @return none
+ *
+ * @note If __LIBI2C_ASYNC_ISR is set to 1, then this function will not
+ * exist and will be replaced by a definition of the master I2C interrupt
+ * of the module selected by _I2C_NUM.
+ **************************************************************************/
+
+#if __LIBI2C_ASYNC_ISR == 1
+void __attribute__ ((interrupt, no_auto_psv)) __I2C_ISR(_I2C_NUM)(){
+#else
+void i2c_update(){
+#endif
+    i2c_txn_t *txn = i2c_head;
+    _I2C_IF = 0;
+
+    if(!txn){
+        _I2C_IE = 0;
+        return;
+    }
+
+    // a collision returns the module to idle without a stop condition
+    if(_I2C_STAT.BCL){
+        _I2C_STAT.BCL = 0;
+        i2c_error = _EEPROM_BUS_COLLISION | i2c_stage[txn->state];
+        __i2c_finish(txn);
+        return;
+    }
+    if(_I2C_STAT.IWCOL){
+        _I2C_STAT.IWCOL = 0;
+        __i2c_fail(txn, _EEPROM_WRITE_BUF_COLLISION);
+        return;
+    }
+
+    switch(txn->state){
+    case _S_START:
+        if(txn->prefix_size || txn->write_size || !txn->read_size){
+            txn->state = _S_ADDR_W;
+            _I2C_TRN = txn->address << 1;
+        }
+        else{
+            txn->state = _S_ADDR_R;
+            _I2C_TRN = (txn->address << 1) | 1;
+        }
+        break;
+
+    case _S_ADDR_W:
+    case _S_WRITE:
+        if(_I2C_STAT.ACKSTAT){
+            __i2c_fail(txn, _EEPROM_NOT_RESPONDING);
+            break;
+        }
+        __i2c_send_next(txn);
+        break;
+
+    case _S_RSTART:
+        txn->state = _S_ADDR_R;
+        _I2C_TRN = (txn->address << 1) | 1;
+        break;
+
+    case _S_ADDR_R:
+        if(_I2C_STAT.ACKSTAT){
+            __i2c_fail(txn, _EEPROM_NOT_RESPONDING);
+            break;
+        }
+        txn->count = 0;
+        txn->state = _S_READ;
+        _I2C_CON.RCEN = 1;
+        break;
+
+    case _S_READ:
+        if(_I2C_STAT.I2COV){
+            _I2C_STAT.I2COV = 0;
+            __i2c_fail(txn, _EEPROM_READ_BUF_OVERFLOW);
+            break;
+        }
+        i2c_rx->read[i2c_rx->count++] = _I2C_RCV;
+        i2c_rx_left--;
+        if(i2c_rx->count == i2c_rx->read_size && i2c_rx->merged){
+            i2c_rx = i2c_rx->merged;
+        }
+        txn->state = _S_ACK;
+        _I2C_CON.ACKDT = i2c_rx_left ? 0 : 1;
+        _I2C_CON.ACKEN = 1;
+        break;
+
+    case _S_ACK:
+        if(i2c_rx_left){
+            txn->state = _S_READ;
+            _I2C_CON.RCEN = 1;
+        }
+        else{
+            txn->state = _S_STOP;
+            _I2C_CON.PEN = 1;
+        }
+        break;
+
+    case _S_STOP:
+        __i2c_finish(txn);
+        break;
+    }
+}
+
+int __i2c_merge(i2c_txn_t *leader, i2c_txn_t *txn){
+    i2c_txn_t *last;
+    uint32_t size, end;
+
+    if(!(leader->flags & I2C_MEMORY_READ) || !leader->read_size
+            || leader->address != txn->address
+            || txn->priority > leader->priority){
+        return 0;
+    }
+
+    size = leader->read_size;
+    for(last = leader; last->merged; last = last->merged){
+        size += last->merged->read_size;
+    }
+    end = (((uint16_t) leader->prefix[0] << 8) | leader->prefix[1]) + size;
+    if(end >= _EEPROM_CHIP_SIZE || size + txn->read_size > 0xffff
+            || end != (((uint32_t) txn->prefix[0] << 8) | txn->prefix[1])){
+        return 0;
+    }
+
+    last->merged = txn;
+    i2c_merge_count++;
+    return 1;
+}
+
+/**
+ * @param txn Transaction to be queued.
+ *
+ * @brief Queues a transaction.
+ *
+ * Adds the transaction to the queue behind every transaction of the same
+ * or higher priority and starts it right away if the bus is idle. The
+ * transaction on the bus is never interrupted. This returns immediately.
+ * The descriptor is the handle of the request: its status becomes
+ * #I2C_DONE or #I2C_ERROR once it is complete, after which its callback
+ * is called from inside the interrupt.
+ *
+ * A read flagged with #I2C_MEMORY_READ that starts where a queued read
+ * of the same device ends is appended to it, so both are done in a
+ * single sequential read.
+ *
+ * @return 0 on success or -1 if the transaction is already queued.
+ **************************************************************************/
+
+int i2c_submit(i2c_txn_t *txn){
+    i2c_txn_t *volatile *link;
+    i2c_txn_t *item;
+    uint8_t enabled;
+
+    if(txn->status == I2C_PENDING || txn->status == I2C_BUSY){
+        return -1;
+    }
+    txn->status = I2C_PENDING;
+    txn->error = 0;
+    txn->count = 0;
+    txn->next = 0;
+    txn->merged = 0;
+
+    enabled = _I2C_IE;
+    _I2C_IE = 0;
+    _I2C_IP = _I2C_ISR_PRIORITY;
+    if(!i2c_head){
+        i2c_head = txn;
+        __i2c_begin(txn);
+        return 0;
+    }
+
+    // the head is already on the bus so only the ones behind it can change
+    if((txn->flags & I2C_MEMORY_READ) && txn->read_size){
+        for(item = i2c_head->next; item; item = item->next){
+            if(__i2c_merge(item, txn)){
+                _I2C_IE = enabled;
+                return 0;
+            }
+        }
+    }
+
+    link = &i2c_head->next;
+    while(*link && (*link)->priority >= txn->priority){
+        link = &(*link)->next;
+    }
+    txn->next = *link;
+    *link = txn;
+    _I2C_IE = enabled;
+    return 0;
+}
+
+/**
+ * @param txn Transaction to wait for.
+ *
+ * @brief Waits for a transaction to complete.
+ *
+ * @return 0 if the transaction completed successfully or -1 if it failed.
+ **************************************************************************/
+
+int i2c_wait(i2c_txn_t *txn){
+    // the Nop gives the host simulator in host/ a point to run the bus
+    while(txn->status == I2C_PENDING || txn->status == I2C_BUSY){
+        Nop();
+    }
+    return (txn->status == I2C_DONE) ? 0 : -1;
+}
+
+/**
+ * @param txn Transaction to check.
+ *
+ * @brief Polls the progress of a transaction.
+ *
+ * @return The status of the transaction, one of the I2C_* status values.
+ **************************************************************************/
+
+uint8_t i2c_status(i2c_txn_t *txn){
+    return txn->status;
+}
+
+/**
+ * @param txn Transaction to check.
+ *
+ * @brief Checks if a transaction is over without waiting.
+ *
+ * Meant to be waited for with TB_AWAIT() in coroutines, in place of
+ * i2c_wait(). The outcome is then given by the status of the transaction.
+ *
+ * @return 1 if the transaction completed or failed, or was never
+ * submitted, 0 while it is queued or on the bus.
+ **************************************************************************/
+
+int i2c_done(i2c_txn_t *txn){
+    return txn->status != I2C_PENDING && txn->status != I2C_BUSY;
+}
+
+/**
+ * @brief Gives the number of merged reads.
+ *
+ * @return The number of reads that were merged into another read since
+ * the start of the program.
+ **************************************************************************/
+
+uint16_t i2c_merged(){
+    return i2c_merge_count;
+}
+
+/**
+ * @brief Checks if there are transactions in progress.
+ *
+ * @return 1 if the queue is not empty or 0 if the bus is free.
+ **************************************************************************/
+
+int i2c_busy(){
+    return i2c_head != 0;
+}
+
+/**
+ * @brief Waits for every queued transaction to complete.
+ *
+ * @return none
+ **************************************************************************/
+
+void i2c_flush(){
+    while(i2c_head){
+        Nop();
+    }
+}
+
+/**
+ * @param txn Transaction to be filled in.
+ * @param buf Buffer for the bytes read.
+ * @param size Number of bytes to read.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ *
+ * @brief Sets up a sequential EEPROM read.
+ *
+ * Fills in the transaction to read *size* bytes starting at
+ * *mem_address* in a single transaction with #I2C_PRIORITY_LOW. The
+ * callback and context are left untouched. The transaction must then be
+ * queued with i2c_submit().
+ *
+ * @return none
+ **************************************************************************/
+
+void i2c_eeprom_read(i2c_txn_t *txn, char *buf, int size, uint16_t mem_address, char dev_address){
+    txn->address = 0x50 | (dev_address & 7);
+    txn->flags = I2C_MEMORY_READ;
+    txn->priority = I2C_PRIORITY_LOW;
+    txn->prefix[0] = mem_address >> 8;
+    txn->prefix[1] = mem_address & 0xff;
+    txn->prefix_size = 2;
+    txn->write = 0;
+    txn->write_size = 0;
+    txn->read = (uint8_t *) buf;
+    txn->read_size = size;
+    txn->status = I2C_IDLE;
+}
+
+/**
+ * @param txn Transaction to be filled in.
+ * @param data Bytes to be written.
+ * @param size Number of bytes to write.
+ * @param mem_address Address of the first byte in the chip.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ *
+ * @brief Sets up an EEPROM page write.
+ *
+ * Fills in the transaction to write *size* bytes starting at
+ * *mem_address* with #I2C_PRIORITY_LOW. The callback and context are
+ * left untouched. The transaction must then be queued with i2c_submit().
+ *
+ * @return none
+ *
+ * @note The bytes must not cross a page boundary and the chip must not
+ * be in a write cycle, otherwise the transaction fails with
+ * #_EEPROM_NOT_RESPONDING. Use EEPROM_write_done() to check.
+ **************************************************************************/
+
+void i2c_eeprom_write(i2c_txn_t *txn, char *data, int size, uint16_t mem_address, char dev_address){
+    txn->address = 0x50 | (dev_address & 7);
+    txn->flags = I2C_EEPROM_WRITE;
+    txn->priority = I2C_PRIORITY_LOW;
+    txn->prefix[0] = mem_address >> 8;
+    txn->prefix[1] = mem_address & 0xff;
+    txn->prefix_size = 2;
+    txn->write = (uint8_t *) data;
+    txn->write_size = size;
+    txn->read = 0;
+    txn->read_size = 0;
+    txn->status = I2C_IDLE;
+}
+
+/**
+ * @param txn Transaction to be filled in.
+ * @param dev_address Address of the chip set by its A0-A2 pins.
+ *
+ * @brief Sets up an acknowledge poll of an EEPROM chip.
+ *
+ * Fills in the transaction to send only the control byte of the chip
+ * followed by a stop, with #I2C_PRIORITY_LOW. It completes with #I2C_DONE
+ * once the chip has finished its write cycle, or fails with
+ * #_EEPROM_NOT_RESPONDING while the chip is still writing. The callback
+ * and context are left untouched. The transaction must then be queued
+ * with i2c_submit().
+ *
+ * @return none
+ **************************************************************************/
+
+void i2c_eeprom_poll(i2c_txn_t *txn, char dev_address){
+    txn->address = 0x50 | (dev_address & 7);
+    txn->flags = 0;
+    txn->priority = I2C_PRIORITY_LOW;
+    txn->prefix_size = 0;
+    txn->write = 0;
+    txn->write_size = 0;
+    txn->read = 0;
+    txn->read_size = 0;
+    txn->status = I2C_IDLE;
+}
+
+#endif
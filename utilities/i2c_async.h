@@ -0,0 +1,129 @@
+/**
+ * @file  i2c_async.h
+ * @brief This file contains function wrappers for interrupt driven I2C
+ * @author Jaime Bronozo
+ *
+ * This is a header file for i2c_async.c which must be included to any
+ * source files that require I2C transfers that run in the background.
+ * This library is dynamically included in the main header
+ * PIC24_toolbox.h
+ *
+ * @date December 3, 2018
+ **************************************************************************/
+
+#ifndef __I2C_ASYNC_TOOLBOX_H__
+#define __I2C_ASYNC_TOOLBOX_H__
+
+/**
+ * @def I2C_IDLE
+ *
+ * @brief Status of a transaction that has not been submitted.
+ *
+ * @def I2C_PENDING
+ *
+ * @brief Status of a transaction waiting in the queue.
+ *
+ * @def I2C_BUSY
+ *
+ * @brief Status of the transaction currently on the bus.
+ *
+ * @def I2C_DONE
+ *
+ * @brief Status of a transaction that completed successfully.
+ *
+ * @def I2C_ERROR
+ *
+ * @brief Status of a transaction that failed. The reason is stored in
+ * its *error* field using the same codes as EEPROM_error() and
+ * EEPROM_error2().
+ **************************************************************************/
+#define I2C_IDLE 0
+#define I2C_PENDING 1
+#define I2C_BUSY 2
+#define I2C_DONE 3
+#define I2C_ERROR 4
+
+/**
+ * @def I2C_EEPROM_WRITE
+ *
+ * @brief Flag for transactions that start an EEPROM write cycle.
+ *
+ * Marks the chip as busy on completion so that the blocking functions of
+ * eeprom.c wait for the write cycle before using it.
+ **************************************************************************/
+#define I2C_EEPROM_WRITE 0x1
+
+/**
+ * @def I2C_MEMORY_READ
+ *
+ * @brief Flag for reads of a memory with a 16-bit address prefix.
+ *
+ * Queued transactions with this flag that read consecutive addresses of
+ * the same device are merged into a single sequential read. Set by
+ * i2c_eeprom_read().
+ **************************************************************************/
+#define I2C_MEMORY_READ 0x2
+
+/**
+ * @def I2C_PRIORITY_LOW
+ *
+ * @brief Lowest transaction priority.
+ *
+ * @def I2C_PRIORITY_HIGH
+ *
+ * @brief Highest transaction priority.
+ **************************************************************************/
+#define I2C_PRIORITY_LOW 0
+#define I2C_PRIORITY_HIGH 255
+
+/**
+ * @brief I2C transaction descriptor.
+ *
+ * Describes a complete transaction: a start, the slave address, the
+ * *prefix* bytes followed by the *write* bytes, then if *read_size* is
+ * not zero a repeated start, the slave address again and *read_size*
+ * bytes read, and finally a stop. The descriptor and its buffers must
+ * stay valid until the transaction completes. The status must be set to
+ * #I2C_IDLE before the first submission.
+ **************************************************************************/
+typedef struct i2c_txn_s {
+    uint8_t address;        ///< 7-bit slave address.
+    uint8_t flags;          ///< Combination of the I2C_* flags.
+    uint8_t priority;       ///< Higher values are sent first.
+    uint8_t prefix_size;    ///< Number of bytes used in *prefix*.
+    uint8_t prefix[2];      ///< Bytes sent before *write*, eg. an address.
+    uint8_t *write;         ///< Bytes to send.
+    uint16_t write_size;    ///< Number of bytes to send.
+    uint8_t *read;          ///< Buffer for received bytes.
+    uint16_t read_size;     ///< Number of bytes to receive.
+    void (*done)(struct i2c_txn_s *txn); ///< Called on completion or 0.
+    void *context;          ///< Free for use by the callback.
+    volatile uint8_t status; ///< One of the I2C_* status values.
+    uint32_t error;         ///< Error code if the status is #I2C_ERROR.
+
+    // maintained by the library
+    uint8_t state;
+    uint16_t count;
+    struct i2c_txn_s *next;
+    struct i2c_txn_s *merged;
+} i2c_txn_t;
+
+int i2c_submit(i2c_txn_t *txn);
+int i2c_wait(i2c_txn_t *txn);
+uint8_t i2c_status(i2c_txn_t *txn);
+int i2c_done(i2c_txn_t *txn);
+uint16_t i2c_merged();
+int i2c_busy();
+void i2c_flush();
+
+void i2c_eeprom_read(i2c_txn_t *txn, char *buf, int size, uint16_t mem_address, char dev_address);
+void i2c_eeprom_write(i2c_txn_t *txn, char *data, int size, uint16_t mem_address, char dev_address);
+void i2c_eeprom_poll(i2c_txn_t *txn, char dev_address);
+
+#if __LIBI2C_ASYNC_ISR == 1
+void __attribute__ ((interrupt, no_auto_psv)) __I2C_ISR(_I2C_NUM)(void);
+#else
+void i2c_update(void);
+#endif
+
+#endif
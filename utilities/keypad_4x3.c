@@ -19,6 +19,7 @@
 #define __LIBKEYPAD_4x3_SETTINGS
 
 #include "toolbox_settings.h"
+#include "ticker.h"
 #include "keypad_4x3.h"
 
 #if __LIBKEYPAD_4x3_DISABLE != 1
@@ -214,6 +215,93 @@ void keypad_update(){
 #endif
 }
 
+#if __LIBTICKER_DISABLE != 1
+/// @cond
+#define __KEYPAD_ANY_ROW() \
+    (!(__PORTx(_ROW1) & __PORTx(_ROW2) & __PORTx(_ROW3) & __PORTx(_ROW4)))
+/// @endcond
+
+uint8_t keypad_state = 0;
+uint32_t keypad_next_us = 0;
+
+/**
+ * @brief Updates the keypad value without waiting.
+ *
+ * A polled replacement of keypad_update() for use with
+ * __LIBKEYPAD_4x3_CNISR set to 0 and the change notification interrupt
+ * left disabled. The 1.5ms debounce and the 10us settling of each column
+ * are kept, but waited for across calls instead of with delay_us(), so
+ * each call only reads the pins and takes one step of the scan. Call it
+ * every millisecond or so, such as from a task of the scheduler library.
+ * Requires ticker_begin().
+ * 
+ * @return The same value as keypad_number().
+ **************************************************************************/
+
+short int keypad_service(){
+    uint32_t now = ticker_us();
+    short int row;
+
+    if((int32_t) (now - keypad_next_us) < 0){
+        return keypad_number();
+    }
+
+    if(!__PORTx(_ROW1))
+        row = 0x0;
+    else if(!__PORTx(_ROW2))
+        row = 0x4;
+    else if(!__PORTx(_ROW3))
+        row = 0x8;
+    else if(!__PORTx(_ROW4))
+        row = 0xc;
+    else
+        row = -1;
+
+    switch(keypad_state){
+    case 0:
+        if(row < 0){
+            keypad_value &= 0xe0;
+        }
+        else if(!(keypad_value & 0x13)){
+            keypad_state = 1;
+            keypad_next_us = now + 1500;
+        }
+        break;
+    case 1:
+        if(row < 0){
+            keypad_value &= 0xe0;
+            keypad_state = 0;
+            break;
+        }
+        keypad_value = (keypad_value & 0xe0) | row;
+        __LATx(_COL2) = 1;
+        __LATx(_COL3) = 1;
+        keypad_state = 2;
+        keypad_next_us = now + 10;
+        break;
+    case 2:
+        if(__KEYPAD_ANY_ROW()){
+            __LATx(_COL2) = 0;
+            __LATx(_COL3) = 0;
+            keypad_value |= 0x1;
+            keypad_state = 0;
+            break;
+        }
+        __LATx(_COL1) = 1;
+        __LATx(_COL2) = 0;
+        keypad_state = 3;
+        keypad_next_us = now + 10;
+        break;
+    default:
+        __LATx(_COL1) = 0;
+        __LATx(_COL3) = 0;
+        keypad_value |= __KEYPAD_ANY_ROW() ? 0x2 : 0x3;
+        keypad_state = 0;
+        break;
+    }
+    return keypad_number();
+}
+#endif
 
 /**
  * @brief Invalidates any current value until the next button press.
@@ -19,6 +19,10 @@ short int keypad_row();
 short int keypad_col();
 void keypad_reset();
 
+#if __LIBTICKER_DISABLE != 1
+short int keypad_service();
+#endif
+
 #if __LIBKEYPAD_4x3_CNISR == 1
 void __attribute__ ((interrupt, no_auto_psv)) _CNInterrupt(void);
 #else
@@ -18,6 +18,7 @@
 #define __LIBLCD_SETTINGS
 
 #include "toolbox_settings.h"
+#include "ticker.h"
 #include "lcd_generic.h"
 
 #if __LIBLCD_DISABLED != 1
@@ -431,6 +432,197 @@ int lcd_num_offset(int number, uint8_t pos, uint8_t offset){
     return length;
 }
 
+#if __LIBTICKER_DISABLE != 1
+/// @cond
+#if _LCD_QUEUE & (_LCD_QUEUE - 1) || _LCD_QUEUE > 256
+#error "_LCD_QUEUE must be a power of 2 up to 256"
+#endif
+
+#define _LCD_RS 0x100
+#define _LCD_SLOW 0x200
+/// @endcond
+
+uint16_t lcd_queue[_LCD_QUEUE];
+volatile uint8_t lcd_queue_head = 0;
+volatile uint8_t lcd_queue_tail = 0;
+uint8_t lcd_nibble = 0;
+uint32_t lcd_next_us = 0;
+
+uint8_t __lcd_free(){
+    return (lcd_queue_tail - lcd_queue_head - 1) & (_LCD_QUEUE - 1);
+}
+
+void __lcd_post(uint16_t entry){
+    lcd_queue[lcd_queue_head] = entry;
+    lcd_queue_head = (lcd_queue_head + 1) & (_LCD_QUEUE - 1);
+}
+
+/**
+ * @param a Character to display in the lcd
+ * 
+ * @brief Queues a character for the lcd.
+ *
+ * Works like lcd_char() but returns at once. The character is sent by
+ * lcd_service().
+ * 
+ * @return 1 if the character was queued or 0 if the queue is full.
+ **************************************************************************/
+
+int lcd_post_char(char a){
+    if(!__lcd_free()){
+        return 0;
+    }
+    __lcd_post(_LCD_RS | (uint8_t) a);
+    return 1;
+}
+
+/**
+ * @param str String to display in the lcd
+ * 
+ * @brief Queues a string for the lcd.
+ *
+ * Works like lcd_text() but returns at once. Nothing is queued unless the
+ * whole string fits.
+ * 
+ * @return The number of characters queued, or -1 if the queue is full.
+ **************************************************************************/
+
+int lcd_post_text(char *str){
+    int j = 0;
+
+    while(str[j] != '\0'){
+        j++;
+    }
+    if(j > __lcd_free()){
+        return -1;
+    }
+    for(j = 0; str[j] != '\0'; j++){
+        __lcd_post(_LCD_RS | (uint8_t) str[j]);
+    }
+    return j;
+}
+
+/**
+ * @param pos Sets the line at which the cursor will start. Use flags
+ * #CURSOR_BOTTOM to place the cursor at the bottom line or #CURSOR_TOP
+ * to place the cursor at the top line.
+ * @param offset Sets the offset of the cursor position from the start of
+ * the line.
+ * 
+ * @brief Queues a cursor move for the lcd.
+ *
+ * Works like lcd_cursor() but returns at once.
+ * 
+ * @return 1 if the command was queued or 0 if the queue is full.
+ **************************************************************************/
+
+int lcd_post_cursor(uint8_t pos, uint8_t offset){
+    if(!__lcd_free()){
+        return 0;
+    }
+    __lcd_post(0x80 | pos | offset);
+    return 1;
+}
+
+/**
+ * @brief Queues a clear of the lcd.
+ *
+ * Works like lcd_clear() but returns at once. The commands queued after
+ * it are held back for the 15.2ms the clear takes.
+ * 
+ * @return 1 if the command was queued or 0 if the queue is full.
+ **************************************************************************/
+
+int lcd_post_clear(){
+    if(!__lcd_free()){
+        return 0;
+    }
+    __lcd_post(_LCD_SLOW | 0x1);
+    return 1;
+}
+
+/**
+ * @brief Sends the queued data to the lcd without waiting.
+ *
+ * Does at most one step each call: sending the upper 4 bits of the next
+ * queued byte, or its lower 4 bits once 100us have passed since the upper
+ * ones. The next byte is held back for 40us, or 15.2ms after a clear, as
+ * done by the other lcd functions. Call it often, such as from a task of
+ * the scheduler library, and do not use the other lcd functions while
+ * data is queued. Requires ticker_begin().
+ * 
+ * @return The number of bytes left to send, 0 once the lcd is idle.
+ **************************************************************************/
+
+int lcd_service(){
+    uint16_t entry;
+    uint32_t now;
+
+    if(lcd_queue_head == lcd_queue_tail){
+        return 0;
+    }
+    now = ticker_us();
+    if((int32_t) (now - lcd_next_us) >= 0){
+        entry = lcd_queue[lcd_queue_tail];
+        if(!lcd_nibble){
+            send_4bits((entry & _LCD_RS) ? 1 : 0, (entry >> 4) & 0xf);
+            lcd_nibble = 1;
+            lcd_next_us = now + 100;
+        }
+        else{
+            send_4bits((entry & _LCD_RS) ? 1 : 0, entry & 0xf);
+            lcd_nibble = 0;
+            lcd_next_us = now + ((entry & _LCD_SLOW) ? 15200 : 40);
+            lcd_queue_tail = (lcd_queue_tail + 1) & (_LCD_QUEUE - 1);
+        }
+    }
+    return (lcd_queue_head - lcd_queue_tail) & (_LCD_QUEUE - 1);
+}
+
+/**
+ * @brief Checks if the lcd can take the next 4 bits.
+ *
+ * Meant to be waited for with TB_AWAIT() in coroutines driving the lcd,
+ * in place of the delays of the blocking functions.
+ * 
+ * @return 1 if nothing is queued for lcd_service() and the wait after the
+ * last data sent is over, 0 otherwise.
+ **************************************************************************/
+
+int lcd_ready(){
+    return lcd_queue_head == lcd_queue_tail
+            && (int32_t) (ticker_us() - lcd_next_us) >= 0;
+}
+
+/**
+ * @param op State of the coroutine, zeroed or set up with TB_INIT() on
+ * op->thread before the first call.
+ * @param str String to display in the lcd
+ * 
+ * @brief Displays a string to the lcd without waiting.
+ *
+ * The coroutine version of lcd_text(), sending the characters the same
+ * way but returning at each wait. Must be called again with the same
+ * string until it returns #TB_DONE. Requires ticker_begin().
+ * 
+ * @return #TB_WAITING while characters are left to send or #TB_DONE once
+ * the whole string is sent.
+ **************************************************************************/
+
+int lcd_text_async(lcd_async_t *op, char *str){
+    TB_BEGIN(&op->thread);
+    for(op->index = 0; str[op->index] != '\0'; op->index++){
+        TB_AWAIT(lcd_ready());
+        send_4bits(1, (str[op->index] >> 4) & 0xf);
+        lcd_next_us = ticker_us() + 100;
+        TB_AWAIT(lcd_ready());
+        send_4bits(1, str[op->index] & 0xf);
+        lcd_next_us = ticker_us() + 40;
+    }
+    TB_END();
+}
+#endif
+
 /**
  * @brief Initializes the lcd for use.
  *
@@ -120,4 +120,25 @@ int lcd_text_offset(char *str, uint8_t pos, uint8_t offset);
 int lcd_num(int number);
 int lcd_num_offset(int number, uint8_t pos, uint8_t offset);
 
+#if __LIBTICKER_DISABLE != 1
+/**
+ * @brief State of a coroutine of the lcd library.
+ *
+ * Passed to lcd_text_async(), which keeps its place in the string here
+ * between calls.
+ **************************************************************************/
+typedef struct {
+    tb_thread_t thread;     ///< State of the coroutine.
+    uint16_t index;         ///< Next character to send.
+} lcd_async_t;
+
+int lcd_post_char(char a);
+int lcd_post_text(char *str);
+int lcd_post_cursor(uint8_t pos, uint8_t offset);
+int lcd_post_clear();
+int lcd_service();
+int lcd_ready();
+int lcd_text_async(lcd_async_t *op, char *str);
+#endif
+
 #endif
\ No newline at end of file
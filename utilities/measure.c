@@ -0,0 +1,294 @@
+/**
+ * @file  measure.c
+ * @brief This file contains function wrappers for signal measurements
+ * @author Jaime Bronozo
+ *
+ * This is a library for measuring the RMS value, mean, peak, trough and
+ * frequency of a sampled signal without floating point math. Samples are
+ * accumulated one at a time by meas_sample(), usually from inside the ADC
+ * interrupt, using only additions, comparisons and a single 16-bit
+ * multiplication. At the end of every window of 2^n samples the
+ * accumulators are latched and the results are computed by meas_result()
+ * from the main loop, where the square root and the single division of
+ * the frequency measurement are done.
+ *
+ * The frequency is measured from the rising crossings of the window mean,
+ * which is tracked from window to window, with hysteresis to reject
+ * noise.
+ *
+ * A window must hold several periods of the signal. Fed from the ADC
+ * scan, every channel is sampled adc_monitor_rate times a second, set by
+ * _ADC_MONITOR_SPS, so a window lasts 2^n / _ADC_MONITOR_SPS seconds. At
+ * the default 1000 samples a second a window of 2^8 samples covers 12.8
+ * periods of 50Hz mains and 15.4 of 60Hz with 16 to 20 samples a period,
+ * and the largest window of 2^12 samples covers 4 seconds. The scan rate
+ * must be at least a few times the highest frequency of interest and low
+ * enough that a window is not over before a few periods have passed.
+ *
+ * @date November 28, 2018
+ **************************************************************************/
+
+/// @cond
+#include "toolbox_settings.h"
+#include "adcread.h"
+#include "measure.h"
+
+#if __LIBMEASURE_DISABLE != 1
+/// @endcond
+
+/// @cond
+#define _MEAS_SHIFT_MAX 12
+/// @endcond
+
+meas_t *meas_list = 0;
+
+void __meas_latch(meas_t *meas){
+    if(meas->ready){
+        meas->overrun++;
+    }
+    else{
+        meas->done_sum = meas->sum;
+        meas->done_squares = meas->squares;
+        meas->done_offset = meas->offset;
+        meas->done_peak = meas->peak;
+        meas->done_trough = meas->trough;
+        meas->done_crossings = meas->crossings;
+        meas->done_span = meas->last - meas->first;
+        meas->ready = 1;
+    }
+
+    // follow the mean so the crossings stay centered on the signal
+    meas->offset += meas->sum >> meas->shift;
+    meas->sum = 0;
+    meas->squares = 0;
+    meas->count = 0;
+    meas->peak = 0;
+    meas->trough = 0xffff;
+    meas->crossings = 0;
+}
+
+/**
+ * @param meas Measurement to be set up.
+ * @param channel Analog pin number to take samples from when attached to
+ * the ADC scan, or 0xff to only take samples through meas_sample().
+ * @param window_shift Window size as a power of two, from 1 to 12.
+ * @param sample_rate Number of samples per second given through
+ * meas_sample(). Ignored when a channel is given, since the ADC scan
+ * gives adc_monitor_rate samples per second.
+ * @param hysteresis Distance from the mean in counts that the signal must
+ * move before a crossing is counted.
+ *
+ * @brief Starts a measurement.
+ *
+ * Clears the accumulators and, if a channel is given, adds it to the ADC
+ * scan and attaches meas_adc_hook() so the measurement is fed from the
+ * ADC interrupt. ADC_monitor_begin() must be called afterwards to start
+ * the scan.
+ *
+ * @return 0 on success or -1 if the window size is out of range.
+ **************************************************************************/
+
+int meas_begin(meas_t *meas, uint8_t channel, uint8_t window_shift, uint32_t sample_rate, uint16_t hysteresis){
+    meas_t *item;
+
+    if(window_shift < 1 || window_shift > _MEAS_SHIFT_MAX){
+        return -1;
+    }
+
+    meas->channel = channel;
+    meas->shift = window_shift;
+    meas->rate = sample_rate;
+    meas->hysteresis = hysteresis;
+    meas->offset = 512;
+    meas->above = 0;
+    meas->ready = 0;
+    meas->overrun = 0;
+    meas->first = 0;
+    meas->last = 0;
+    meas->sum = 0;
+    meas->squares = 0;
+    meas->count = 0;
+    meas->peak = 0;
+    meas->trough = 0xffff;
+    meas->crossings = 0;
+
+    if(channel == 0xff){
+        return 0;
+    }
+
+    for(item = meas_list; item; item = item->next){
+        if(item == meas){
+            break;
+        }
+    }
+    if(!item){
+        meas->next = meas_list;
+        meas_list = meas;
+    }
+
+    meas->rate = adc_monitor_rate;
+    ADC_scan(channel);
+    ADC_attach(meas_adc_hook);
+    return 0;
+}
+
+/**
+ * @param meas Measurement to be stopped.
+ *
+ * @brief Stops feeding a measurement from the ADC scan.
+ *
+ * The channel is left in the ADC scan.
+ *
+ * @return none
+ **************************************************************************/
+
+void meas_end(meas_t *meas){
+    meas_t **item;
+    for(item = &meas_list; *item; item = &(*item)->next){
+        if(*item == meas){
+            *item = meas->next;
+            break;
+        }
+    }
+}
+
+/**
+ * @param meas Measurement to add the sample to.
+ * @param value Sample value in ADC counts.
+ *
+ * @brief Adds a sample to a measurement.
+ *
+ * This is safe to call from inside an interrupt. Its cost is a handful of
+ * additions and comparisons plus one 16-bit multiplication, except once
+ * per window where the accumulators are latched.
+ *
+ * @return none
+ **************************************************************************/
+
+void meas_sample(meas_t *meas, uint16_t value){
+    int16_t delta = value - meas->offset;
+
+    meas->sum += delta;
+    meas->squares += (int32_t) delta * delta;
+    if(value > meas->peak){
+        meas->peak = value;
+    }
+    if(value < meas->trough){
+        meas->trough = value;
+    }
+
+    if(meas->above){
+        if(delta < -(int16_t) meas->hysteresis){
+            meas->above = 0;
+        }
+    }
+    else if(delta > (int16_t) meas->hysteresis){
+        meas->above = 1;
+        if(!meas->crossings){
+            meas->first = meas->count;
+        }
+        meas->last = meas->count;
+        meas->crossings++;
+    }
+
+    if(++meas->count == (1 << meas->shift)){
+        __meas_latch(meas);
+    }
+}
+
+/**
+ * @param meas Measurement to get the results of.
+ * @param result Structure to be filled in with the results.
+ *
+ * @brief Computes the results of the latest completed window.
+ *
+ * Must be called from the main loop at least once per window, otherwise
+ * newer windows are discarded until the latest one is read.
+ *
+ * @return 1 if a new result was stored or 0 if no window has been
+ * completed since the last call.
+ **************************************************************************/
+
+int meas_result(meas_t *meas, meas_result_t *result){
+    int32_t mean;
+    uint32_t square;
+    uint64_t frequency;
+
+    if(!meas->ready){
+        return 0;
+    }
+
+    mean = meas->done_sum >> meas->shift;
+    square = meas->done_squares >> meas->shift;
+    if(square > (uint32_t) (mean * mean)){
+        result->rms = meas_isqrt(square - mean * mean);
+    }
+    else{
+        result->rms = 0;
+    }
+    result->mean = meas->done_offset + mean;
+    result->peak = meas->done_peak;
+    result->trough = meas->done_trough;
+
+    result->frequency = 0;
+    if(meas->done_crossings >= 2 && meas->done_span){
+        frequency = (uint64_t) (meas->done_crossings - 1) * meas->rate * 1000;
+        result->frequency = frequency / meas->done_span;
+    }
+
+    meas->ready = 0;
+    return 1;
+}
+
+/**
+ * @param channel Analog pin number the sample came from.
+ * @param value Sample value.
+ *
+ * @brief Feeds the ADC scan to the started measurements.
+ *
+ * Attached to the ADC scan by meas_begin(). This passes the sample to
+ * every measurement started on the channel.
+ *
+ * @return none
+ **************************************************************************/
+
+void meas_adc_hook(uint8_t channel, uint16_t value){
+    meas_t *meas;
+    for(meas = meas_list; meas; meas = meas->next){
+        if(meas->channel == channel){
+            meas_sample(meas, value);
+        }
+    }
+}
+
+/**
+ * @param value Number to get the square root of.
+ *
+ * @brief Computes an integer square root.
+ *
+ * Uses the digit by digit method with shifts and subtractions only.
+ *
+ * @return The square root of *value* rounded down.
+ **************************************************************************/
+
+uint16_t meas_isqrt(uint32_t value){
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while(bit > value){
+        bit >>= 2;
+    }
+    while(bit){
+        if(value >= root + bit){
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else{
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+#endif
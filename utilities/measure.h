@@ -0,0 +1,74 @@
+/**
+ * @file  measure.h
+ * @brief This file contains function wrappers for signal measurements
+ * @author Jaime Bronozo
+ *
+ * This is a header file for measure.c which must be included to any
+ * source files that require RMS, peak or frequency measurements of
+ * analog signals. This library is dynamically included in the main
+ * header PIC24_toolbox.h
+ *
+ * @date November 28, 2018
+ **************************************************************************/
+
+#ifndef __MEASURE_TOOLBOX_H__
+#define __MEASURE_TOOLBOX_H__
+
+/**
+ * @brief Results of a measurement window.
+ *
+ * All values except the frequency are in raw ADC counts. The RMS value is
+ * that of the signal with its mean removed.
+ **************************************************************************/
+typedef struct {
+    uint16_t rms;       ///< RMS value of the AC component.
+    uint16_t mean;      ///< Mean (DC) value.
+    uint16_t peak;      ///< Highest sample.
+    uint16_t trough;    ///< Lowest sample.
+    uint32_t frequency; ///< Frequency in millihertz or 0 if unknown.
+} meas_result_t;
+
+/**
+ * @brief Accumulators of a measurement.
+ *
+ * One of these is needed for every signal being measured. The contents
+ * are maintained by meas_sample() and must not be modified directly.
+ **************************************************************************/
+typedef struct meas_s {
+    uint8_t channel;
+    uint8_t shift;
+    uint8_t above;
+    volatile uint8_t ready;
+    uint16_t hysteresis;
+    uint16_t offset;
+    uint16_t count;
+    uint16_t peak;
+    uint16_t trough;
+    uint16_t crossings;
+    uint16_t first;
+    uint16_t last;
+    int32_t sum;
+    uint32_t squares;
+    uint32_t rate;
+
+    // accumulators latched at the end of a window
+    int32_t done_sum;
+    uint32_t done_squares;
+    uint16_t done_offset;
+    uint16_t done_peak;
+    uint16_t done_trough;
+    uint16_t done_crossings;
+    uint16_t done_span;
+    uint16_t overrun;
+
+    struct meas_s *next;
+} meas_t;
+
+int meas_begin(meas_t *meas, uint8_t channel, uint8_t window_shift, uint32_t sample_rate, uint16_t hysteresis);
+void meas_end(meas_t *meas);
+void meas_sample(meas_t *meas, uint16_t value);
+int meas_result(meas_t *meas, meas_result_t *result);
+void meas_adc_hook(uint8_t channel, uint16_t value);
+uint16_t meas_isqrt(uint32_t value);
+
+#endif
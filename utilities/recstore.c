@@ -0,0 +1,291 @@
+/**
+ * @file  recstore.c
+ * @brief This file contains function wrappers for the EEPROM record store
+ * @author Jaime Bronozo
+ *
+ * This is a library for keeping small, frequently updated records in an
+ * EEPROM region without wearing out a single location. The region is
+ * split into slots used as a ring. Every write appends a new version of
+ * the record to the next free slot together with a sequence number and
+ * a checksum, so updates are spread over the whole region. Slots holding
+ * older versions are reused as the ring wraps around while slots holding
+ * the latest version of a record are skipped.
+ *
+ * Since the latest version of a record is never overwritten, a write cut
+ * short by a power loss only damages a slot that held nothing of value.
+ * The damaged slot fails its checksum and record_begin() falls back to
+ * the previous version.
+ *
+ * @date December 8, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBEEPROM_I2C_SETTINGS
+#define __LIBRECSTORE_SETTINGS
+
+#include "toolbox_settings.h"
+#include "eeprom.h"
+#include "recstore.h"
+
+#if __LIBRECSTORE_DISABLE != 1
+
+#if __LIBEEPROM_I2C_DISABLE == 1
+#error "recstore.c requires the eeprom library to be enabled"
+#endif
+
+#define __RECORD_SLOTS ((_RECSTORE_END - _RECSTORE_START) / _RECSTORE_SLOT_SIZE)
+#define __RECORD_NONE 0xffff
+
+#if _EEPROM_PAGE_SIZE % _RECSTORE_SLOT_SIZE != 0 || _RECSTORE_SLOT_SIZE % 2 != 0
+#error "_RECSTORE_SLOT_SIZE must be even and divide _EEPROM_PAGE_SIZE"
+#endif
+
+#if _RECSTORE_START % _RECSTORE_SLOT_SIZE != 0
+#error "_RECSTORE_START must be aligned to _RECSTORE_SLOT_SIZE"
+#endif
+
+#if _RECSTORE_KEYS >= __RECORD_SLOTS || _RECSTORE_KEYS > 255
+#error "the record store region must have more slots than _RECSTORE_KEYS"
+#endif
+/// @endcond
+
+/**
+ * @brief A slot of the record store.
+ *
+ * Internal structure written to the EEPROM with a single page write. An
+ * erased slot reads as key 0xff and is ignored.
+ **************************************************************************/
+typedef struct {
+    uint32_t sequence;
+    uint8_t key;
+    uint8_t size;
+    uint8_t data[RECORD_DATA_SIZE];
+    uint16_t check;
+} record_slot_t;
+
+uint16_t record_slot[_RECSTORE_KEYS];
+uint32_t record_version[_RECSTORE_KEYS];
+uint16_t record_next = 0;
+uint32_t record_count = 0;
+
+uint16_t __record_check(record_slot_t *rec){
+    uint8_t *p = (uint8_t *) rec;
+    uint16_t a = 1, b = 1;
+    int i;
+
+    for(i = 0; i < _RECSTORE_SLOT_SIZE - 2; i++){
+        a = (a + p[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (b << 8) | a;
+}
+
+uint16_t __record_address(uint16_t slot){
+    return _RECSTORE_START + slot * _RECSTORE_SLOT_SIZE;
+}
+
+int __record_live(uint16_t slot){
+    int i;
+    for(i = 0; i < _RECSTORE_KEYS; i++){
+        if(record_slot[i] == slot){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int __record_verify(uint16_t slot){
+    record_slot_t rec;
+    if(EEPROM_read_block((char *) &rec, _RECSTORE_SLOT_SIZE,
+            __record_address(slot), _RECSTORE_DEV) < 0){
+        return -1;
+    }
+    return rec.check == __record_check(&rec) && rec.size <= RECORD_DATA_SIZE;
+}
+
+/**
+ * @brief Finds the latest version of every record.
+ *
+ * Must be called once at start up before using the other functions of
+ * the record store. Only the sequence number and key of each slot are
+ * read, then the checksum of the latest version of each record is
+ * checked. A version failing its checksum is skipped and the scan is
+ * repeated to find the version before it.
+ *
+ * @return The number of records found or -1 if the EEPROM cannot be
+ * read.
+ **************************************************************************/
+
+int record_begin(){
+    uint8_t bad[(__RECORD_SLOTS + 7) / 8];
+    struct {
+        uint32_t sequence;
+        uint8_t key;
+    } head;
+    uint16_t slot, last = __RECORD_NONE;
+    int i, found, check;
+
+    for(i = 0; i < (int) sizeof(bad); i++){
+        bad[i] = 0;
+    }
+
+    do{
+        for(i = 0; i < _RECSTORE_KEYS; i++){
+            record_slot[i] = __RECORD_NONE;
+        }
+        for(slot = 0; slot < __RECORD_SLOTS; slot++){
+            if(bad[slot >> 3] & (1 << (slot & 7))){
+                continue;
+            }
+            if(EEPROM_read_block((char *) &head, 5, __record_address(slot), _RECSTORE_DEV) < 0){
+                return -1;
+            }
+            if(head.key >= _RECSTORE_KEYS){
+                continue;
+            }
+            if(record_slot[head.key] == __RECORD_NONE || head.sequence > record_version[head.key]){
+                record_slot[head.key] = slot;
+                record_version[head.key] = head.sequence;
+            }
+        }
+
+        // a damaged slot is left out and the scan repeated
+        check = 1;
+        for(i = 0; i < _RECSTORE_KEYS && check == 1; i++){
+            slot = record_slot[i];
+            if(slot != __RECORD_NONE){
+                check = __record_verify(slot);
+                if(check == 0){
+                    bad[slot >> 3] |= 1 << (slot & 7);
+                }
+            }
+        }
+        if(check < 0){
+            return -1;
+        }
+    }while(check == 0);
+
+    found = 0;
+    record_count = 0;
+    for(i = 0; i < _RECSTORE_KEYS; i++){
+        if(record_slot[i] != __RECORD_NONE){
+            found++;
+            if(last == __RECORD_NONE || record_version[i] >= record_count){
+                last = record_slot[i];
+                record_count = record_version[i] + 1;
+            }
+        }
+    }
+    record_next = last == __RECORD_NONE ? 0 : (last + 1) % __RECORD_SLOTS;
+    return found;
+}
+
+/**
+ * @param key Number of the record, less than _RECSTORE_KEYS.
+ * @param buf Buffer to receive the record.
+ * @param size Size of *buf* in bytes.
+ *
+ * @brief Reads the latest version of a record.
+ *
+ * @return The number of bytes stored in *buf*, 0 if the record was never
+ * written or was erased, or -1 on failure.
+ **************************************************************************/
+
+int record_read(uint8_t key, void *buf, int size){
+    record_slot_t rec;
+    int i;
+
+    if(key >= _RECSTORE_KEYS){
+        return -1;
+    }
+    if(record_slot[key] == __RECORD_NONE){
+        return 0;
+    }
+    if(EEPROM_read_block((char *) &rec, _RECSTORE_SLOT_SIZE,
+            __record_address(record_slot[key]), _RECSTORE_DEV) < 0){
+        return -1;
+    }
+
+    if(size > rec.size){
+        size = rec.size;
+    }
+    for(i = 0; i < size; i++){
+        ((uint8_t *) buf)[i] = rec.data[i];
+    }
+    return size;
+}
+
+/**
+ * @param key Number of the record, less than _RECSTORE_KEYS.
+ * @param data New contents of the record.
+ * @param size Size of *data* in bytes, up to #RECORD_DATA_SIZE.
+ *
+ * @brief Writes a new version of a record.
+ *
+ * The new version is written to the next slot of the ring that does not
+ * hold the latest version of any record, using a single page write. The
+ * previous version stays in the EEPROM until its slot is reused.
+ *
+ * @return The number of bytes written or -1 on failure.
+ **************************************************************************/
+
+int record_write(uint8_t key, void *data, int size){
+    record_slot_t rec;
+    uint16_t slot = record_next;
+    int i;
+
+    if(key >= _RECSTORE_KEYS || size < 0 || size > RECORD_DATA_SIZE){
+        return -1;
+    }
+    while(__record_live(slot)){
+        slot = (slot + 1) % __RECORD_SLOTS;
+    }
+
+    rec.sequence = record_count;
+    rec.key = key;
+    rec.size = size;
+    for(i = 0; i < RECORD_DATA_SIZE; i++){
+        rec.data[i] = i < size ? ((uint8_t *) data)[i] : 0xff;
+    }
+    rec.check = __record_check(&rec);
+
+    if(EEPROM_write_page((char *) &rec, _RECSTORE_SLOT_SIZE,
+            __record_address(slot), _RECSTORE_DEV) < 0){
+        return -1;
+    }
+
+    record_slot[key] = slot;
+    record_version[key] = record_count++;
+    record_next = (slot + 1) % __RECORD_SLOTS;
+    return size;
+}
+
+/**
+ * @param key Number of the record, less than _RECSTORE_KEYS.
+ *
+ * @brief Erases a record.
+ *
+ * Writes an empty version of the record so that record_read() returns 0
+ * for it.
+ *
+ * @return 0 on success or -1 on failure.
+ **************************************************************************/
+
+int record_erase(uint8_t key){
+    return record_write(key, 0, 0) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Gives the sequence number of the next write.
+ *
+ * This is also the total number of writes made to the record store
+ * since it was first used.
+ *
+ * @return The next sequence number.
+ **************************************************************************/
+
+uint32_t record_sequence(){
+    return record_count;
+}
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file  recstore.h
+ * @brief This file contains function wrappers for the EEPROM record store
+ * @author Jaime Bronozo
+ *
+ * This is a header file for recstore.c which must be included to any
+ * source files that require small records kept in EEPROM across resets.
+ * This library is dynamically included in the main header
+ * PIC24_toolbox.h
+ *
+ * @date December 8, 2018
+ **************************************************************************/
+
+#ifndef __RECSTORE_TOOLBOX_H__
+#define __RECSTORE_TOOLBOX_H__
+
+/**
+ * @def RECORD_DATA_SIZE
+ *
+ * @brief Largest record that fits in a slot.
+ **************************************************************************/
+#define RECORD_DATA_SIZE (_RECSTORE_SLOT_SIZE - 8)
+
+int record_begin();
+int record_read(uint8_t key, void *buf, int size);
+int record_write(uint8_t key, void *data, int size);
+int record_erase(uint8_t key);
+uint32_t record_sequence();
+
+#endif
@@ -0,0 +1,267 @@
+/**
+ * @file  sched.c
+ * @brief This file contains function wrappers for the task scheduler
+ * @author Jaime Bronozo
+ *
+ * This is a library running the drivers of the toolbox and the
+ * application as cooperative tasks from a single loop, instead of each
+ * stalling the CPU in delay_us() or a polling loop of its own. Each task
+ * is a function doing one short step, such as lcd_service(),
+ * keypad_service(), ADC_service() or EEPROM_service(), and returning.
+ *
+ * A task is released every *period* microseconds, or by sched_ready() from
+ * an interrupt or another task when its period is 0. sched_step() runs the
+ * released task of highest priority, so a long step of a low priority task
+ * delays the others by at most its own length. Periodic releases are kept
+ * on their grid so tasks do not drift.
+ *
+ * Every run is timed with ticker_us(). A run finishing later than its
+ * deadline after its release counts as missed, and so does every release
+ * of a periodic task skipped because it ran too late. Together with the
+ * execution times these show which tasks need shorter steps or a higher
+ * priority, and sched_load() gives the share of time spent in tasks.
+ *
+ * ```C
+ * sched_task_t lcd_task, keypad_task;
+ *
+ * void lcd_step(sched_task_t *task){
+ *     lcd_service();
+ * }
+ *
+ * void keypad_step(sched_task_t *task){
+ *     keypad_service();
+ * }
+ *
+ * ticker_begin();
+ * sched_begin();
+ * sched_add(&keypad_task, keypad_step, 1000, 0, 2);
+ * sched_add(&lcd_task, lcd_step, 50, 1000, 1);
+ * sched_run();
+ * ```
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBSCHED_SETTINGS
+
+#include "toolbox_settings.h"
+#include "ticker.h"
+#include "sched.h"
+
+#if __LIBSCHED_DISABLE != 1
+
+#if __LIBTICKER_DISABLE == 1
+#error "sched.c requires the ticker library to be enabled"
+#endif
+/// @endcond
+
+sched_task_t *sched_head = 0;
+uint32_t sched_busy_us = 0;
+uint32_t sched_window_us = 0;
+
+void __sched_stats_clear(sched_task_t *task){
+    task->runs = 0;
+    task->missed = 0;
+    task->exec_last = 0;
+    task->exec_max = 0;
+    task->exec_total = 0;
+    task->late_max = 0;
+}
+
+/**
+ * @brief Starts the scheduler with no tasks.
+ *
+ * ticker_begin() must be called first.
+ *
+ * @return none
+ **************************************************************************/
+
+void sched_begin(){
+    sched_head = 0;
+    sched_busy_us = 0;
+    sched_window_us = ticker_us();
+}
+
+/**
+ * @param task Task to be added.
+ * @param run Step of the task.
+ * @param period Microseconds between releases, or 0 for a task released
+ * only by sched_ready().
+ * @param deadline Microseconds from a release by which the run must be
+ * over, or 0 to use the period. A task with neither is never late.
+ * @param priority Priority of the task, higher values run first. Tasks of
+ * the same priority run in the order they were added.
+ *
+ * @brief Adds a task to the scheduler.
+ *
+ * A periodic task is released at once. The task must not already be in
+ * the scheduler.
+ *
+ * @return none
+ **************************************************************************/
+
+void sched_add(sched_task_t *task, sched_run_t run, uint32_t period, uint32_t deadline, uint8_t priority){
+    sched_task_t **link = &sched_head;
+
+    task->run = run;
+    task->period = period;
+    task->deadline = deadline;
+    task->priority = priority;
+    task->release = ticker_us();
+    task->ready = 0;
+    __sched_stats_clear(task);
+
+    while(*link && (*link)->priority >= priority){
+        link = &(*link)->next;
+    }
+    task->next = *link;
+    *link = task;
+}
+
+/**
+ * @param task Task to be removed.
+ *
+ * @brief Removes a task from the scheduler.
+ *
+ * A task may remove itself while it runs.
+ *
+ * @return none
+ **************************************************************************/
+
+void sched_remove(sched_task_t *task){
+    sched_task_t **link;
+
+    for(link = &sched_head; *link; link = &(*link)->next){
+        if(*link == task){
+            *link = task->next;
+            task->next = 0;
+            return;
+        }
+    }
+}
+
+/**
+ * @param task Task to be released.
+ *
+ * @brief Releases a task with a period of 0.
+ *
+ * Can be called from an interrupt. The deadline counts from the first
+ * release, and releasing a task again before it runs does nothing.
+ *
+ * @return none
+ **************************************************************************/
+
+void sched_ready(sched_task_t *task){
+    if(!task->ready){
+        task->release = ticker_us();
+        task->ready = 1;
+    }
+}
+
+/**
+ * @brief Runs the released task of highest priority.
+ *
+ * Runs at most one task so the caller can do other work between steps.
+ *
+ * @return 1 if a task was run or 0 if none was released.
+ **************************************************************************/
+
+int sched_step(){
+    sched_task_t *task;
+    uint32_t now, end, release, exec, deadline, skipped;
+
+    now = ticker_us();
+    for(task = sched_head; task; task = task->next){
+        if(task->period ? (int32_t) (now - task->release) >= 0 : task->ready){
+            break;
+        }
+    }
+    if(!task){
+        return 0;
+    }
+
+    release = task->release;
+    if(task->period){
+        task->release += task->period;
+        if((int32_t) (now - task->release) >= 0){
+            skipped = (now - task->release) / task->period + 1;
+            task->missed += skipped;
+            task->release += skipped * task->period;
+        }
+    }
+    else{
+        task->ready = 0;
+    }
+
+    task->run(task);
+    end = ticker_us();
+
+    exec = end - now;
+    task->runs++;
+    task->exec_last = exec;
+    task->exec_total += exec;
+    if(exec > task->exec_max){
+        task->exec_max = exec;
+    }
+    if(now - release > task->late_max){
+        task->late_max = now - release;
+    }
+    deadline = task->deadline ? task->deadline : task->period;
+    if(deadline && end - release > deadline){
+        task->missed++;
+    }
+    sched_busy_us += exec;
+    return 1;
+}
+
+/**
+ * @brief Runs the tasks forever.
+ *
+ * @return none
+ **************************************************************************/
+
+void sched_run(){
+    while(1){
+        sched_step();
+    }
+}
+
+/**
+ * @brief Gives the share of time spent running tasks.
+ *
+ * Counted since sched_begin() or sched_stats_clear(), which should be
+ * called at least once every 71 minutes for this to stay meaningful.
+ *
+ * @return The load in tenths of a percent, from 0 to 1000.
+ **************************************************************************/
+
+uint16_t sched_load(){
+    uint32_t elapsed = (ticker_us() - sched_window_us) / 1000;
+
+    if(!elapsed){
+        return 0;
+    }
+    if(sched_busy_us / elapsed > 1000){
+        return 1000;
+    }
+    return sched_busy_us / elapsed;
+}
+
+/**
+ * @brief Clears the statistics of all tasks and of sched_load().
+ *
+ * @return none
+ **************************************************************************/
+
+void sched_stats_clear(){
+    sched_task_t *task;
+
+    for(task = sched_head; task; task = task->next){
+        __sched_stats_clear(task);
+    }
+    sched_busy_us = 0;
+    sched_window_us = ticker_us();
+}
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file  sched.h
+ * @brief This file contains function wrappers for the task scheduler
+ * @author Jaime Bronozo
+ *
+ * This is a header file for sched.c which must be included to any source
+ * files that add tasks to the scheduler. This library is dynamically
+ * included in the main header PIC24_toolbox.h
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+#ifndef __SCHED_TOOLBOX_H__
+#define __SCHED_TOOLBOX_H__
+
+struct sched_task_s;
+
+/**
+ * @brief Function doing one step of a task.
+ *
+ * Called with the task being run, so one function can serve several tasks
+ * through their *context*. It must return without waiting.
+ **************************************************************************/
+typedef void (*sched_run_t)(struct sched_task_s *task);
+
+/**
+ * @brief Task of the scheduler.
+ *
+ * Set up with sched_add(). All times are in microseconds of ticker_us().
+ * The statistics are kept for every run and cleared by sched_add() and
+ * sched_stats_clear(). The other fields are maintained by the library.
+ **************************************************************************/
+typedef struct sched_task_s {
+    sched_run_t run;            ///< Step of the task.
+    void *context;              ///< Free for the use of the task.
+    uint32_t period;            ///< Time between releases, 0 for sched_ready().
+    uint32_t deadline;          ///< Time from release to finish, 0 for the period.
+    uint8_t priority;           ///< Ready tasks with higher values run first.
+
+    uint32_t runs;              ///< Number of runs.
+    uint32_t missed;            ///< Runs finished late plus releases skipped.
+    uint32_t exec_last;         ///< Execution time of the last run.
+    uint32_t exec_max;          ///< Longest execution time.
+    uint32_t exec_total;        ///< Sum of the execution times, modulo 2^32.
+    uint32_t late_max;          ///< Longest time from release to start.
+
+    // maintained by the library
+    uint32_t release;
+    volatile uint8_t ready;
+    struct sched_task_s *next;
+} sched_task_t;
+
+void sched_begin();
+void sched_add(sched_task_t *task, sched_run_t run, uint32_t period, uint32_t deadline, uint8_t priority);
+void sched_remove(sched_task_t *task);
+void sched_ready(sched_task_t *task);
+int sched_step();
+void sched_run();
+uint16_t sched_load();
+void sched_stats_clear();
+
+#endif
@@ -0,0 +1,334 @@
+/**
+ * @file  ticker.c
+ * @brief This file contains function wrappers for the system time base
+ * @author Jaime Bronozo
+ *
+ * This is a library giving the toolbox a notion of time without stalling
+ * the CPU. Timer1 interrupts once every _TICKER_TICK_US microseconds and
+ * counts the ticks, from which ticker_us() and ticker_ms() give 32-bit
+ * monotonic clocks. ticker_us() adds the time within the current tick
+ * read from Timer1 and wraps around after about 71 minutes, while
+ * ticker_ms() wraps around after about 49 days.
+ *
+ * Software timers are kept in a hashed timer wheel of _TICKER_SLOTS
+ * slots, each a doubly linked list of the timers expiring on a tick with
+ * the same low bits. Starting, stopping and expiring a timer are a fixed
+ * number of pointer updates however many timers are running, and each
+ * tick only looks at the timers of one slot. Timers running longer than
+ * _TICKER_SLOTS ticks are passed over until their tick comes round.
+ *
+ * Expiries are only counted in the interrupt. The application or a driver
+ * takes them with ticker_fired() instead of waiting with delay_us().
+ *
+ * ```C
+ * ticker_t blink;
+ *
+ * ticker_begin();
+ * ticker_start(&blink, 0, TICKER_MS(500));
+ * while(1){
+ *     if(ticker_fired(&blink)){
+ *         toggle_led();
+ *     }
+ *     other_work();
+ * }
+ * ```
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+/// @cond
+#define __LIBTICKER_SETTINGS
+
+#include "toolbox_settings.h"
+#include "ticker.h"
+
+#if __LIBTICKER_DISABLE != 1
+
+#if _TICKER_TICK_US < 1 || _TICKER_TICK_US > 65535
+#error "_TICKER_TICK_US must be from 1 to 65535"
+#endif
+
+#if _TICKER_SLOTS & (_TICKER_SLOTS - 1)
+#error "_TICKER_SLOTS must be a power of 2"
+#endif
+
+#define __TICKER_CYCLES ((FCY) * 1ULL * _TICKER_TICK_US / 1000000ULL)
+
+// the smallest prescaler that fits the tick in the 16-bit period register
+#if __TICKER_CYCLES <= 0x10000ULL
+#define __TICKER_TCKPS 0
+#define __TICKER_PERIOD (__TICKER_CYCLES)
+#elif __TICKER_CYCLES / 8 <= 0x10000ULL
+#define __TICKER_TCKPS 1
+#define __TICKER_PERIOD (__TICKER_CYCLES / 8)
+#elif __TICKER_CYCLES / 64 <= 0x10000ULL
+#define __TICKER_TCKPS 2
+#define __TICKER_PERIOD (__TICKER_CYCLES / 64)
+#else
+#define __TICKER_TCKPS 3
+#define __TICKER_PERIOD (__TICKER_CYCLES / 256)
+#endif
+
+#if __TICKER_PERIOD > 0x10000ULL || __TICKER_PERIOD < 1
+#error "_TICKER_TICK_US cannot be made with Timer1 at this FCY"
+#endif
+
+#define _TICKER_PERIOD ((uint32_t) __TICKER_PERIOD)
+/// @endcond
+
+ticker_t *ticker_wheel[_TICKER_SLOTS];
+volatile uint32_t ticker_count = 0;
+volatile uint32_t ticker_base_us = 0;
+volatile uint32_t ticker_base_ms = 0;
+volatile uint16_t ticker_frac_us = 0;
+
+void __ticker_link(ticker_t *timer){
+    ticker_t **slot = &ticker_wheel[timer->expires & (_TICKER_SLOTS - 1)];
+
+    timer->prev = 0;
+    timer->next = *slot;
+    if(*slot){
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+    timer->active = 1;
+}
+
+void __ticker_unlink(ticker_t *timer){
+    if(timer->prev){
+        timer->prev->next = timer->next;
+    }
+    else{
+        ticker_wheel[timer->expires & (_TICKER_SLOTS - 1)] = timer->next;
+    }
+    if(timer->next){
+        timer->next->prev = timer->prev;
+    }
+    timer->next = 0;
+    timer->prev = 0;
+    timer->active = 0;
+}
+
+/**
+ * @brief Starts the Timer1 tick.
+ *
+ * Clears the clocks and all the timers. Timer1 must not be used by
+ * anything else afterwards.
+ *
+ * @return none
+ **************************************************************************/
+
+void ticker_begin(){
+    int i;
+
+    T1CONbits.TON = 0;
+    _T1IE = 0;
+    for(i = 0; i < _TICKER_SLOTS; i++){
+        ticker_wheel[i] = 0;
+    }
+    ticker_count = 0;
+    ticker_base_us = 0;
+    ticker_base_ms = 0;
+    ticker_frac_us = 0;
+
+    T1CONbits.TCS = 0;
+    T1CONbits.TGATE = 0;
+    T1CONbits.TCKPS = __TICKER_TCKPS;
+    TMR1 = 0;
+    PR1 = _TICKER_PERIOD - 1;
+    _T1IF = 0;
+#if __LIBTICKER_ISR == 1
+    _T1IP = _TICKER_ISR_PRIORITY;
+    _T1IE = 1;
+#endif
+    T1CONbits.TON = 1;
+}
+
+/**
+ * @brief Gives the number of ticks since ticker_begin().
+ *
+ * @return The tick count, modulo 2^32.
+ **************************************************************************/
+
+uint32_t ticker_ticks(){
+    uint32_t count;
+    uint8_t enabled = _T1IE;
+
+    _T1IE = 0;
+    count = ticker_count;
+    _T1IE = enabled;
+    return count;
+}
+
+/**
+ * @brief Gives the time in microseconds.
+ *
+ * A tick that is due but not yet handled, such as while a higher priority
+ * interrupt runs, is counted so the clock never goes back.
+ *
+ * @return Microseconds since ticker_begin(), modulo 2^32.
+ **************************************************************************/
+
+uint32_t ticker_us(){
+    uint32_t base;
+    uint16_t count;
+    uint8_t enabled = _T1IE;
+
+    _T1IE = 0;
+    base = ticker_base_us;
+    count = TMR1;
+    if(_T1IF){
+        base += _TICKER_TICK_US;
+        count = TMR1;
+    }
+    _T1IE = enabled;
+    return base + (uint32_t) count * _TICKER_TICK_US / _TICKER_PERIOD;
+}
+
+/**
+ * @brief Gives the time in milliseconds.
+ *
+ * @return Milliseconds since ticker_begin(), modulo 2^32.
+ **************************************************************************/
+
+uint32_t ticker_ms(){
+    uint32_t base, frac;
+    uint16_t count;
+    uint8_t enabled = _T1IE;
+
+    _T1IE = 0;
+    base = ticker_base_ms;
+    frac = ticker_frac_us;
+    count = TMR1;
+    if(_T1IF){
+        frac += _TICKER_TICK_US;
+        count = TMR1;
+    }
+    _T1IE = enabled;
+    frac += (uint32_t) count * _TICKER_TICK_US / _TICKER_PERIOD;
+    return base + frac / 1000;
+}
+
+/**
+ * @param timer Timer to be started.
+ * @param delay Ticks until the first expiry.
+ * @param period Ticks between expiries, or 0 for a one-shot timer.
+ *
+ * @brief Starts a software timer.
+ *
+ * The first expiry comes after at least *delay* ticks and at most one
+ * more, since the current tick is already partly over. A periodic timer
+ * then expires every *period* ticks counted from the first expiry, so it
+ * does not drift however late its expiries are taken. A running timer is
+ * restarted and its untaken expiries are dropped. Use TICKER_MS() to give
+ * the times in milliseconds.
+ *
+ * @return none
+ **************************************************************************/
+
+void ticker_start(ticker_t *timer, uint32_t delay, uint32_t period){
+    uint8_t enabled = _T1IE;
+
+    _T1IE = 0;
+    if(timer->active){
+        __ticker_unlink(timer);
+    }
+    timer->expires = ticker_count + delay + 1;
+    timer->period = period;
+    timer->fired = 0;
+    __ticker_link(timer);
+    _T1IE = enabled;
+}
+
+/**
+ * @param timer Timer to be stopped.
+ *
+ * @brief Stops a software timer.
+ *
+ * Expiries counted before the timer was stopped can still be taken.
+ *
+ * @return none
+ **************************************************************************/
+
+void ticker_stop(ticker_t *timer){
+    uint8_t enabled = _T1IE;
+
+    _T1IE = 0;
+    if(timer->active){
+        __ticker_unlink(timer);
+    }
+    _T1IE = enabled;
+}
+
+/**
+ * @param timer Timer to be checked.
+ *
+ * @brief Takes the expiries of a software timer.
+ *
+ * @return The number of expiries since the last call, 0 if none.
+ **************************************************************************/
+
+uint16_t ticker_fired(ticker_t *timer){
+    uint16_t fired;
+    uint8_t enabled;
+
+    // a quick look first so polling does not hold off the tick
+    if(!timer->fired){
+        return 0;
+    }
+    enabled = _T1IE;
+    _T1IE = 0;
+    fired = timer->fired;
+    timer->fired = 0;
+    _T1IE = enabled;
+    return fired;
+}
+
+/**
+ * @fn void ticker_update()
+ * @brief Handles a tick of Timer1.
+ *
+ * This function must be called inside the Timer1 interrupt when
+ * __LIBTICKER_ISR is set to 0. This allows the library to coexist with
+ * code that requires the use of the interrupt.
+ *
+ * @return none
+ *
+ * @note If __LIBTICKER_ISR is set to 1, then this function will not
+ * exist and will be replaced by a definition of the Timer1 interrupt.
+ **************************************************************************/
+
+#if __LIBTICKER_ISR == 1
+void __attribute__ ((interrupt, no_auto_psv)) _T1Interrupt(){
+#else
+void ticker_update(){
+#endif
+    ticker_t *timer, *next;
+    uint32_t count;
+
+    _T1IF = 0;
+    count = ++ticker_count;
+    ticker_base_us += _TICKER_TICK_US;
+    ticker_base_ms += _TICKER_TICK_US / 1000;
+    ticker_frac_us += _TICKER_TICK_US % 1000;
+    if(ticker_frac_us >= 1000){
+        ticker_frac_us -= 1000;
+        ticker_base_ms++;
+    }
+
+    for(timer = ticker_wheel[count & (_TICKER_SLOTS - 1)]; timer; timer = next){
+        next = timer->next;
+        if(timer->expires != count){
+            continue;
+        }
+        // a periodic timer goes back to the head of a slot already passed
+        __ticker_unlink(timer);
+        timer->fired++;
+        if(timer->period){
+            timer->expires += timer->period;
+            __ticker_link(timer);
+        }
+    }
+}
+
+#endif
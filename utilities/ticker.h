@@ -0,0 +1,66 @@
+/**
+ * @file  ticker.h
+ * @brief This file contains function wrappers for the system time base
+ * @author Jaime Bronozo
+ *
+ * This is a header file for ticker.c which must be included to any source
+ * files that require the monotonic clock or software timers. This library
+ * is dynamically included in the main header PIC24_toolbox.h
+ *
+ * @date December 15, 2018
+ **************************************************************************/
+
+#ifndef __TICKER_TOOLBOX_H__
+#define __TICKER_TOOLBOX_H__
+
+/**
+ * @def TICKER_US(d)
+ * @param d Time in unit microseconds.
+ *
+ * @brief Converts microseconds to ticks, rounded up.
+ *
+ * @def TICKER_MS(d)
+ * @param d Time in unit milliseconds.
+ *
+ * @brief Converts milliseconds to ticks, rounded up.
+ *
+ * Both are folded by the compiler when given a constant.
+ **************************************************************************/
+#define TICKER_US(d) ((uint32_t) \
+    ((((unsigned long long) (d)) + _TICKER_TICK_US - 1)/_TICKER_TICK_US))
+#define TICKER_MS(d) TICKER_US(((unsigned long long) (d))*1000ULL)
+
+/**
+ * @brief Software timer.
+ *
+ * Started with ticker_start(). Expiries are counted in *fired* by the
+ * tick interrupt and taken with ticker_fired(). The fields are maintained
+ * by the library.
+ **************************************************************************/
+typedef struct ticker_s {
+    uint32_t expires;           ///< Tick count of the next expiry.
+    uint32_t period;            ///< Ticks between expiries, 0 for one-shot.
+    volatile uint16_t fired;    ///< Expiries not yet taken.
+    volatile uint8_t active;    ///< 1 while the timer is running.
+
+    // maintained by the library
+    struct ticker_s *next;
+    struct ticker_s *prev;
+} ticker_t;
+
+void ticker_begin();
+uint32_t ticker_ticks();
+uint32_t ticker_us();
+uint32_t ticker_ms();
+
+void ticker_start(ticker_t *timer, uint32_t delay, uint32_t period);
+void ticker_stop(ticker_t *timer);
+uint16_t ticker_fired(ticker_t *timer);
+
+#if __LIBTICKER_ISR == 1
+void __attribute__ ((interrupt, no_auto_psv)) _T1Interrupt(void);
+#else
+void ticker_update(void);
+#endif
+
+#endif
@@ -38,9 +38,61 @@
 /// @cond
 #include "xc.h"
 #include "libpic30.h"
+#include "coroutine.h"
 /// @endcond
 
 /** 
+ * @def _DELAY_OVERHEAD
+ * 
+ * @brief Instruction cycles of a delay not counted by __delay32()
+ * 
+ * Every delay is shortened by this many cycles to make up for the
+ * instructions loading the cycle count and calling **__delay32()**. The
+ * value depends on the compiler version and optimization level, so it is
+ * best measured once per build with delay_overhead() of the delay library
+ * and entered here.
+ * 
+ * @def _DELAY_RUN_OVERHEAD
+ * 
+ * @brief Instruction cycles of a delay with a runtime argument not
+ * counted by __delay32()
+ * 
+ * Same as _DELAY_OVERHEAD for delays whose argument is not a constant,
+ * which also pay for the call converting it to cycles. Measure it with
+ * delay_run_overhead() of the delay library.
+ * 
+ * @def _DELAY_MIN
+ * 
+ * @brief Shortest delay __delay32() can give in instruction cycles
+ * 
+ * Shorter delays are lengthened to this many cycles rather than wrapping
+ * around to a delay of minutes.
+ **************************************************************************/
+#define _DELAY_OVERHEAD 2
+#define _DELAY_RUN_OVERHEAD 30
+#define _DELAY_MIN 12
+
+/** 
+ * @def delay_cycles(c)
+ * @param c Number of instruction cycles.
+ * 
+ * @brief Stalls execution for a number of instruction cycles.
+ * 
+ * Calls **__delay32()** with _DELAY_OVERHEAD cycles taken off and the
+ * result kept at no less than _DELAY_MIN, so a delay is never shorter
+ * than asked for. With a constant argument the arithmetic is done by the
+ * compiler and a delay that does not fit in 32 bits fails to compile.
+ * 
+ * Any other argument is evaluated once and handed to **__delay_run()**
+ * of delay.c, which converts it with a single 32-bit multiplication and
+ * takes off _DELAY_RUN_OVERHEAD instead. The cycles per unit are then
+ * rounded up, so delay_us() is up to one microsecond per microsecond long
+ * when Fcy is not a whole number of MHz, and a delay over 2^32 cycles is
+ * cut to 2^32 - 1.
+ * 
+ * @note Interrupts taken during the delay lengthen it. Use delay_until()
+ * of the delay library where this matters.
+ * 
  * @def delay_s(d)
  * @param d Time in unit seconds.
  * 
@@ -59,24 +111,49 @@
  * 
  * Functions as a definite time delay function wrapped around the
  * **__delay32()** function. This converts the number milliseconds to stall
- * to its equivalent cycle count.
+ * to its equivalent cycle count, rounded up.
  * 
  * @note This function is dependent on the proper setting of Fcy.
  * 
  * @def delay_us(d)
  * @param d Time in unit microseconds.
  * 
- * @brief Stalls execution of instructions in microseconds/
+ * @brief Stalls execution of instructions in microseconds.
  * 
  * Functions as a definite time delay function wrapped around the 
  * **__delay32()** function. This converts the number microseconds to stall
- * to its equivalent cycle count.
+ * to its equivalent cycle count, rounded up.
  * 
- * @note This function is dependent on the proper setting of Fcy.
+ * @note This function is dependent on the proper setting of Fcy. At low
+ * Fcy, short delays are lengthened to _DELAY_MIN cycles.
  **************************************************************************/
-#define delay_s(d)  __delay32( (unsigned long) ((((unsigned long long) d)*(FCY))-2))
-#define delay_ms(d) __delay32( (unsigned long) ((((unsigned long long) d)*(FCY)/1000ULL)-2))
-#define delay_us(d) __delay32( (unsigned long) ((((unsigned long long) d)*(FCY)/1000000ULL)-2))
+#define delay_cycles(c) __DELAY_TIME(c, FCY)
+#define delay_s(d)  __DELAY_TIME(d, 1ULL)
+#define delay_ms(d) __DELAY_TIME(d, 1000ULL)
+#define delay_us(d) __DELAY_TIME(d, 1000000ULL)
+
+/// @cond
+// only the branch matching the argument is compiled in, which evaluates it once
+#define __DELAY_TIME(d, unit) do{ \
+    if(__builtin_constant_p(d)){ \
+        __DELAY_CHECK(__DELAY_CYCLES(d, unit)); \
+        __delay32(__DELAY_ARG(__DELAY_CYCLES(d, unit))); \
+    } \
+    else{ \
+        __delay_run(d, __DELAY_PER(unit), 0xffffffffUL / __DELAY_PER(unit)); \
+    } \
+}while(0)
+#define __DELAY_PER(unit) ((unsigned long) (((FCY) + (unit) - 1)/(unit)))
+#define __DELAY_CYCLES(d, unit) \
+    ((((unsigned long long) (d))*(FCY) + (unit) - 1)/(unit))
+#define __DELAY_ARG(c) ((unsigned long) \
+    ((c) > _DELAY_MIN + _DELAY_OVERHEAD ? (c) - _DELAY_OVERHEAD : _DELAY_MIN))
+// a constant delay over 32 bits gives an array of negative size
+#define __DELAY_CHECK(c) ((void) sizeof(char[1 - 2* \
+    (__builtin_constant_p(c) && (unsigned long long) (c) > 0xffffffffULL)]))
+
+void __delay_run(unsigned long d, unsigned long per_unit, unsigned long limit);
+/// @endcond
 
 
 /** 
@@ -169,6 +246,101 @@
 #define __I2C_TRN(x) __I2C_ACCESS(x, TRN)
 #define __I2C_RCV(x) __I2C_ACCESS(x, RCV)
 
+#define __I2C_INT(x, y) _MI2C##x##y
+#define __I2C_IF(x) __I2C_INT(x, IF)
+#define __I2C_IE(x) __I2C_INT(x, IE)
+#define __I2C_IP(x) __I2C_INT(x, IP)
+#define __I2C_ISR(x) __I2C_INT(x, Interrupt)
+
+/** 
+ * @def __LIBDELAY_DISABLE
+ * 
+ * @brief Set to 1 to disable the timer delay library
+ * 
+ * Enables or disables the timer delay library. Disabling using this
+ * option will automatically exclude compilation of delay.c and remove
+ * delay.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBDELAY_DISABLE 0
+
+#ifdef __LIBDELAY_SETTINGS
+
+/**
+ * @def _DELAY_TIMER
+ * 
+ * @brief Timer holding the low word of the 32-bit delay timer
+ * 
+ * Must be an even numbered timer that can be joined with the next one,
+ * such as Timer2 or Timer4.
+ * 
+ * @def _DELAY_TIMER_MSW
+ * 
+ * @brief Timer holding the high word, always _DELAY_TIMER + 1
+ **************************************************************************/
+#define _DELAY_TIMER 2
+#define _DELAY_TIMER_MSW 3
+
+#endif
+
+/** 
+ * @def __LIBTICKER_DISABLE
+ * 
+ * @brief Set to 1 to disable the ticker library
+ * 
+ * Enables or disables the ticker library. Disabling using this option
+ * will automatically exclude compilation of ticker.c and remove ticker.h
+ * from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBTICKER_DISABLE 0
+
+/**
+ * @def _TICKER_TICK_US
+ * 
+ * @brief Period of the Timer1 tick in microseconds
+ * 
+ * Software timers count in ticks, and the tick is the resolution of
+ * ticker_ms(). ticker_us() reads Timer1 for the time within a tick. Must
+ * be at most 65535. Set outside of the settings section since TICKER_MS()
+ * in ticker.h depends on it.
+ **************************************************************************/
+#define _TICKER_TICK_US 1000
+
+#ifdef __LIBTICKER_SETTINGS
+
+/**
+ * @def __LIBTICKER_ISR
+ * 
+ * @brief Set to 1 to auto-manage the Timer1 interrupt
+ * 
+ * Enables or disables the automatic management of the Timer1 interrupt.
+ * If other functions must integrate with it, the function ticker_update()
+ * must be called inside the interrupt.
+ * 
+ * @def _TICKER_SLOTS
+ * 
+ * @brief Number of slots of the timer wheel, a power of 2
+ * 
+ * A timer is kept in the slot picked by its expiry tick and every tick
+ * looks at a single slot, so each tick costs about the number of running
+ * timers divided by this. Each slot takes a pointer of RAM.
+ **************************************************************************/
+#define __LIBTICKER_ISR 1
+#define _TICKER_ISR_PRIORITY 3
+#define _TICKER_SLOTS 16
+
+#endif
+
+/** 
+ * @def __LIBSCHED_DISABLE
+ * 
+ * @brief Set to 1 to disable the task scheduler library
+ * 
+ * Enables or disables the task scheduler library. Disabling using this
+ * option will automatically exclude compilation of sched.c and remove
+ * sched.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBSCHED_DISABLE 0
+
 /** 
  * @def __LIBLCD_DISABLED
  * 
@@ -241,6 +413,9 @@
 #define _E   B5
 #define _RW  B7
 
+// bytes queued for lcd_service(), a power of 2
+#define _LCD_QUEUE 32
+
 #endif
 
 /** 
@@ -345,20 +520,563 @@
 
 #define __LIBADCREAD_DISABLE 0
 
+/** 
+ * @page adclib Configuring the ADC Library
+ * @tableofcontents
+ * 
+ * This page describes the available settings to modify in the code
+ * section of the ADC library found in toolbox_settings.h.
+ * 
+ * @section adctiming Conversion Timing
+ * 
+ * The ADC clock period (TAD) and the sampling time (SAMC) are computed by
+ * the compiler from FCY, the output impedance of the circuit driving the
+ * analog pins _ADC_SOURCE_OHMS and the lowest acceptable throughput
+ * _ADC_TARGET_SPS in samples per second. The shortest legal TAD is used
+ * and the sampling time is made just long enough to charge the sample
+ * and hold capacitor to within half an LSB, and lengthened further if
+ * the throughput would exceed the rating of the converter _ADC_MAX_SPS.
+ * Compilation fails if the throughput cannot be met.
+ * 
+ * ```C
+ * #define _ADC_SOURCE_OHMS 2500
+ * #define _ADC_TARGET_SPS 50000
+ * ```
+ * 
+ * The electrical characteristics _ADC_TAD_MIN_NS, _ADC_CHOLD_FF,
+ * _ADC_RIC_OHMS and _ADC_RSS_OHMS are taken from the device datasheet.
+ * The computed values can be overridden by defining _SAMPLE_PERIOD and
+ * _ADC_PERIOD directly, in which case they are only checked against the
+ * minimum TAD and _ADC_MAX_SPS.
+ * 
+ * @section adcmonitor Monitoring Rate
+ * 
+ * The monitoring mode scans its channels _ADC_MONITOR_SPS times a second
+ * using Timer3, so every channel in the scan is sampled at that rate. The
+ * samples reach the functions attached with ADC_attach() at the same
+ * rate. A scan of all 16 channels must fit in the conversion time set
+ * above.
+ * 
+ * ```C
+ * #define _ADC_MONITOR_SPS 1000
+ * ```
+ **************************************************************************/
+
 #ifdef __LIBADCREAD_SETTINGS
 
-#define _SAMPLE_PERIOD 2
-#define _ADC_PERIOD 1
+#define _ADC_SOURCE_OHMS 2500
+#define _ADC_TARGET_SPS 50000
+
+#define _ADC_TAD_MIN_NS 75
+#define _ADC_MAX_SPS 500000
+#define _ADC_CHOLD_FF 4400
+#define _ADC_RIC_OHMS 250
+#define _ADC_RSS_OHMS 5000
+
+/**
+ * @def __LIBADCREAD_ISR
+ * 
+ * @brief Set to 1 to auto-manage the ADC interrupt
+ * 
+ * Enables or disables the automatic management of the ADC interrupt used
+ * by the monitoring mode. If other functions must integrate with it, the
+ * interrupt priority and enable must be manually set and the function
+ * ADC_update() be called inside the _ADC1Interrupt() function.
+ **************************************************************************/
+#define __LIBADCREAD_ISR 1
+#define _ADC_ISR_PRIORITY 3
+#define _ADC_MONITOR_SPS 1000
+#define _ADC_EVENT_QUEUE 8
+#define _ADC_HOOKS 2
+
+#endif
+
+/** 
+ * @def __LIBADCCAL_DISABLE
+ * 
+ * @brief Set to 1 to disable the adc calibration library
+ * 
+ * Enables or disables the adc calibration library. Disabling using this
+ * option will automatically exclude compilation of adccal.c and remove
+ * adccal.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBADCCAL_DISABLE 0
+
+/** 
+ * @page adccallib Configuring the ADC Calibration Library
+ * @tableofcontents
+ * 
+ * This page describes the available settings to modify in the code
+ * section of the ADC calibration library found in toolbox_settings.h.
+ * 
+ * @section adccalvbg Supply Voltage Measurement
+ * 
+ * The macro _ADC_VBG_CHANNEL must be set to the channel number that
+ * selects the internal band gap reference of the device and _ADC_VBG_MV
+ * to its nominal voltage in millivolts as found in the datasheet. The
+ * macro _ADC_SUPPLY_MV is used for conversions until
+ * ADC_calibrate_supply() is called.
+ * 
+ * @section adccalntc Thermistor Table
+ * 
+ * The thermistor lookup table is generated by the compiler from the beta
+ * value _ADC_NTC_BETA, the resistance at 25 degrees Celsius _ADC_NTC_R0
+ * and the resistance of the fixed resistor between the thermistor and Vdd
+ * _ADC_NTC_SERIES. The thermistor must be connected between the analog
+ * pin and ground.
+ * 
+ * ```C
+ * #define _ADC_NTC_BETA 3950
+ * #define _ADC_NTC_R0 10000
+ * #define _ADC_NTC_SERIES 10000
+ * ```
+ **************************************************************************/
+
+#ifdef __LIBADCCAL_SETTINGS
+
+#define _ADC_CAL_CHANNELS 16
+#define _ADC_VBG_CHANNEL 15
+#define _ADC_VBG_MV 1200
+#define _ADC_SUPPLY_MV 3300
+
+#define _ADC_NTC_BETA 3950
+#define _ADC_NTC_R0 10000
+#define _ADC_NTC_SERIES 10000
 
 #endif
 
 #define __LIBEEPROM_I2C_DISABLE 0
 
+/** 
+ * @page eepromlib Configuring the I2C EEPROM Library
+ * @tableofcontents
+ * 
+ * This page describes the available settings to modify in the code
+ * section of the I2C EEPROM library found in toolbox_settings.h.
+ * 
+ * @section eeprompin Bus Configuration
+ * 
+ * The macro _I2C_NUM selects the I2C module connected to the EEPROM chips
+ * while _I2C_SDA and _I2C_SCL must be set to the pins of that module.
+ * These pins are driven directly when the bus has to be recovered from a
+ * stuck slave.
+ * 
+ * The macro _I2C_SCL_HZ sets the clock frequency of the bus. The baud
+ * rate is computed from it and FCY at compile time, rounding down the
+ * frequency. Standard mode (100kHz), Fast mode (400kHz) and Fast-mode
+ * Plus (1MHz) are supported, and slew rate control is turned on for Fast
+ * mode only. Fast-mode Plus needs chips rated for it, like the 24FC256,
+ * and stronger pull-ups. The reached frequency and the highest byte rate
+ * are available in eeprom_scl_hz and eeprom_byte_rate. A raw baud rate
+ * register value can be forced by defining _CLOCK_RATE instead.
+ * 
+ * Setting _I2C_SOFTWARE to 1 replaces the I2C module with a software
+ * master on the pins _I2C_SDA and _I2C_SCL, which can then be any two
+ * digital pins with pull-ups. All the EEPROM functions work the same and
+ * slaves stretching the clock are waited for. The timing follows FCY and
+ * _I2C_SCL_HZ, reaching about 300kHz at an FCY of 16MHz, and the pins
+ * must not be analog inputs. The interrupt driven I2C library cannot be
+ * used with the software master.
+ * 
+ * ```C
+ * #define _I2C_SCL_HZ 400000
+ * //#define _CLOCK_RATE 38
+ * #define _I2C_SOFTWARE 0
+ * ```
+ * 
+ * @section eepromchip Chip Geometry
+ * 
+ * The macro _EEPROM_PAGE_SIZE must be set to the page size of the chips
+ * in bytes (64 for the 24LC256, 128 for the 24LC512) and
+ * _EEPROM_CHIP_SIZE to their capacity in bytes. EEPROM_write() uses these
+ * to split writes at page boundaries and to continue on the chip at the
+ * next device address. _EEPROM_WRITE_TIMEOUT_US is the longest time in
+ * microseconds that a chip is polled for the end of its write cycle
+ * before giving up.
+ * 
+ * ```C
+ * #define _EEPROM_PAGE_SIZE 64
+ * #define _EEPROM_CHIP_SIZE 0x8000UL
+ * ```
+ * 
+ * @section eepromtimeout Timeouts and Recovery
+ * 
+ * Every wait on a flag of the I2C module is bounded. The bound is 4 byte
+ * times on the bus computed from _CLOCK_RATE and FCY, counted as loop
+ * iterations of at least 3 instruction cycles. When a wait runs out, the
+ * bus is recovered by clocking SCL until the slave lets go of SDA and
+ * sending a stop, and the whole transfer is tried again up to
+ * _EEPROM_RETRIES times. A transfer lost to a bus collision is recovered
+ * from and tried again the same way, and one the chip does not
+ * acknowledge is ended with a stop so the bus is never left held. Only
+ * transfers that fail again or where the bus cannot be recovered are
+ * reported, with the error code _EEPROM_BUS_TIMEOUT,
+ * _EEPROM_BUS_COLLISION or _EEPROM_FATAL_ERROR.
+ * 
+ * With FCY at 16MHz and _I2C_SCL_HZ at 400000, an SCL period is 40
+ * cycles or 2.5us. The normal and worst case times of each primitive are:
+ * 
+ * Primitive | Normal | Timeout
+ * --------- | ------ | -------
+ * start, repeated start, stop, acknowledge | 2.5us | 90us to 180us
+ * byte sent or received | 22.5us | 90us to 180us
+ * bus recovery | 30us | 240us
+ * 
+ * A transfer that times out therefore takes at most about 0.4ms more per
+ * try than it would normally. The timeouts scale with the SCL period.
+ * The waits actually seen can be read with EEPROM_wait_peak() to check
+ * these figures on the target.
+ * 
+ * ```C
+ * #define _EEPROM_RETRIES 2
+ * ```
+ **************************************************************************/
+
 #ifdef __LIBEEPROM_I2C_SETTINGS
 
-#define _CLOCK_RATE 200//157
+#define _I2C_SCL_HZ 400000
+//#define _CLOCK_RATE 38
+#define _I2C_SOFTWARE 0
 #define _I2C_NUM 1
 #define _I2C_SDA B9
 #define _I2C_SCL B8
 
-#endif
\ No newline at end of file
+#define _EEPROM_PAGE_SIZE 64
+#define _EEPROM_CHIP_SIZE 0x8000UL
+#define _EEPROM_WRITE_TIMEOUT_US 10000
+#define _EEPROM_RETRIES 2
+
+#endif
+
+/** 
+ * @def __LIBI2C_ASYNC_DISABLE
+ * 
+ * @brief Set to 1 to disable the interrupt driven I2C library
+ * 
+ * Enables or disables the interrupt driven I2C library. Disabling using
+ * this option will automatically exclude compilation of i2c_async.c and
+ * remove i2c_async.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBI2C_ASYNC_DISABLE 0
+
+#ifdef __LIBI2C_ASYNC_SETTINGS
+
+/**
+ * @def __LIBI2C_ASYNC_ISR
+ * 
+ * @brief Set to 1 to auto-manage the master I2C interrupt
+ * 
+ * Enables or disables the automatic management of the master I2C
+ * interrupt of the module selected by _I2C_NUM. If other functions must
+ * integrate with it, the interrupt priority and enable must be manually
+ * set and the function i2c_update() be called inside the interrupt.
+ **************************************************************************/
+#define __LIBI2C_ASYNC_ISR 1
+#define _I2C_ISR_PRIORITY 2
+
+#endif
+
+/** 
+ * @def __LIBEEPROM_CACHE_DISABLE
+ * 
+ * @brief Set to 1 to disable the EEPROM cache library
+ * 
+ * Enables or disables the EEPROM cache library. Disabling using this
+ * option will automatically exclude compilation of eeprom_cache.c and
+ * remove eeprom_cache.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBEEPROM_CACHE_DISABLE 0
+
+#ifdef __LIBEEPROM_CACHE_SETTINGS
+
+/**
+ * @def _EEPROM_CACHE_PAGES
+ * 
+ * @brief Number of EEPROM pages kept in RAM
+ * 
+ * Each cached page takes _EEPROM_PAGE_SIZE bytes of RAM plus a few bytes
+ * of bookkeeping.
+ **************************************************************************/
+#define _EEPROM_CACHE_PAGES 4
+
+#endif
+
+/** 
+ * @def __LIBDATALOG_DISABLE
+ * 
+ * @brief Set to 1 to disable the data logger library
+ * 
+ * Enables or disables the data logger library. Disabling using this
+ * option will automatically exclude compilation of datalog.c and remove
+ * datalog.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBDATALOG_DISABLE 0
+
+/** 
+ * @page dataloglib Configuring the Data Logger Library
+ * @tableofcontents
+ * 
+ * This page describes the available settings to modify in the code
+ * section of the data logger library found in toolbox_settings.h.
+ * 
+ * @section datalogregion Log Region
+ * 
+ * The log is written to the EEPROM chip selected by _DATALOG_DEV from
+ * the address _DATALOG_START up to but not including _DATALOG_END. Each
+ * block is written as a single page so _DATALOG_BLOCK_SIZE must not be
+ * larger than the page size of the chip and _DATALOG_START must be
+ * aligned to it. The default region leaves the end of the chip to the
+ * settings and record store libraries.
+ * 
+ * ```C
+ * #define _DATALOG_DEV 0
+ * #define _DATALOG_START 0x0000
+ * #define _DATALOG_END 0x6c00
+ * #define _DATALOG_BLOCK_SIZE 64
+ * ```
+ * 
+ * @section datalograte Logging Rate
+ * 
+ * Every logged channel is sampled _DATALOG_SPS times a second by keeping
+ * one in every _ADC_MONITOR_SPS / _DATALOG_SPS scans of the ADC library.
+ * The blocks must fill slower than the chip writes them, so with 64 byte
+ * blocks _DATALOG_SPS times the number of channels should stay below
+ * about 4800.
+ * 
+ * ```C
+ * #define _DATALOG_SPS 100
+ * ```
+ **************************************************************************/
+
+#ifdef __LIBDATALOG_SETTINGS
+
+#define _DATALOG_DEV 0
+#define _DATALOG_START 0x0000
+#define _DATALOG_END 0x6c00
+#define _DATALOG_BLOCK_SIZE 64
+#define _DATALOG_SPS 100
+
+#endif
+
+/** 
+ * @def __LIBCONFIG_DISABLE
+ * 
+ * @brief Set to 1 to disable the settings library
+ * 
+ * Enables or disables the settings library. Disabling using this option
+ * will automatically exclude compilation of config.c and remove config.h
+ * from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBCONFIG_DISABLE 0
+
+/** 
+ * @page configlib Configuring the Settings Library
+ * @tableofcontents
+ * 
+ * This page describes the available settings to modify in the code
+ * section of the settings library found in toolbox_settings.h.
+ * 
+ * @section configschema Schema
+ * 
+ * The settings kept in EEPROM are declared in _CONFIG_SCHEMA, one FIELD
+ * per setting with the schema version that added it, its type, its name
+ * in the global structure #config and its default value. Array fields
+ * need a typedef for their type.
+ * 
+ * To change the schema, only append new fields with the version number
+ * increased in _CONFIG_VERSION. Fields must never be removed, reordered
+ * or have their type changed, since their place in the EEPROM follows
+ * from their place in the schema. Settings stored by an older version are
+ * loaded as they are and the new fields get their defaults.
+ * 
+ * ```C
+ * #define _CONFIG_VERSION 1
+ * #define _CONFIG_SCHEMA(FIELD) \
+ *     FIELD(1, uint16_t, lcd_contrast, 8) \
+ *     FIELD(1, int16_t, adc_offset, 0) \
+ *     FIELD(1, uint16_t, adc_gain, 0x4000)
+ * ```
+ * 
+ * @section configregion Store Region
+ * 
+ * The settings are kept in the EEPROM chip selected by _CONFIG_DEV from
+ * the address _CONFIG_ADDRESS, in a region of _CONFIG_SIZE bytes. Two
+ * copies of the settings are kept so a save cut short by a power loss
+ * leaves the previous one. Each copy takes 10 bytes more than config_t
+ * rounded up to whole pages, and the build fails if both do not fit in
+ * the region. _CONFIG_ADDRESS must be aligned to the page size.
+ * 
+ * ```C
+ * #define _CONFIG_DEV 0
+ * #define _CONFIG_ADDRESS 0x6c00
+ * #define _CONFIG_SIZE 0x400
+ * ```
+ **************************************************************************/
+
+#define _CONFIG_VERSION 1
+#define _CONFIG_SCHEMA(FIELD) \
+    FIELD(1, uint16_t, lcd_contrast, 8) \
+    FIELD(1, int16_t, adc_offset, 0) \
+    FIELD(1, uint16_t, adc_gain, 0x4000)
+
+#ifdef __LIBCONFIG_SETTINGS
+
+#define _CONFIG_DEV 0
+#define _CONFIG_ADDRESS 0x6c00
+#define _CONFIG_SIZE 0x400
+
+#endif
+
+/** 
+ * @def __LIBRECSTORE_DISABLE
+ * 
+ * @brief Set to 1 to disable the record store library
+ * 
+ * Enables or disables the record store library. Disabling using this
+ * option will automatically exclude compilation of recstore.c and remove
+ * recstore.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBRECSTORE_DISABLE 0
+
+/**
+ * @def _RECSTORE_SLOT_SIZE
+ * 
+ * @brief Size of each slot of the record store in bytes
+ * 
+ * Set outside of the settings section since RECORD_DATA_SIZE in
+ * recstore.h depends on it.
+ **************************************************************************/
+#define _RECSTORE_SLOT_SIZE 16
+
+/** 
+ * @page recstorelib Configuring the Record Store Library
+ * @tableofcontents
+ * 
+ * This page describes the available settings to modify in the code
+ * section of the record store library found in toolbox_settings.h.
+ * 
+ * @section recstoreregion Store Region
+ * 
+ * The records are kept in the EEPROM chip selected by _RECSTORE_DEV from
+ * the address _RECSTORE_START up to but not including _RECSTORE_END. The
+ * region is split into slots of _RECSTORE_SLOT_SIZE bytes, each holding
+ * one version of a record with 8 bytes of overhead. The slot size must
+ * divide the page size of the chip. Records are numbered from 0 up to
+ * _RECSTORE_KEYS - 1, and the region must have more slots than that.
+ * 
+ * A larger region spreads the writes over more cells. With the settings
+ * below, a single record updated over and over is written to each slot
+ * once every 256 updates.
+ * 
+ * ```C
+ * #define _RECSTORE_DEV 0
+ * #define _RECSTORE_START 0x7000
+ * #define _RECSTORE_END 0x8000
+ * #define _RECSTORE_SLOT_SIZE 16
+ * #define _RECSTORE_KEYS 16
+ * ```
+ **************************************************************************/
+
+#ifdef __LIBRECSTORE_SETTINGS
+
+#define _RECSTORE_DEV 0
+#define _RECSTORE_START 0x7000
+#define _RECSTORE_END 0x8000
+#define _RECSTORE_KEYS 16
+
+#endif
+
+/** 
+ * @def __LIBESTREAM_DISABLE
+ * 
+ * @brief Set to 1 to disable the EEPROM stream library
+ * 
+ * Enables or disables the EEPROM stream library. Disabling using this
+ * option will automatically exclude compilation of estream.c and remove
+ * estream.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBESTREAM_DISABLE 0
+
+/**
+ * @def _ESTREAM_BUFFER
+ * 
+ * @brief Size of the read-ahead buffer of each stream in bytes
+ * 
+ * Every stream holds a buffer of this size. Reads smaller than the
+ * buffer fill it with a single sequential read. Set outside of the
+ * settings section since estream_t in estream.h depends on it.
+ **************************************************************************/
+#define _ESTREAM_BUFFER 32
+
+#ifdef __LIBESTREAM_SETTINGS
+
+/**
+ * @def _ESTREAM_CHIPS
+ * 
+ * @brief Number of EEPROM chips in the linear memory
+ * 
+ * The chips must have device addresses from 0 up to _ESTREAM_CHIPS - 1
+ * and be _EEPROM_CHIP_SIZE bytes each.
+ **************************************************************************/
+#define _ESTREAM_CHIPS 1
+
+#endif
+
+/** 
+ * @def __LIBASSET_DISABLE
+ * 
+ * @brief Set to 1 to disable the EEPROM asset library
+ * 
+ * Enables or disables the EEPROM asset library. Disabling using this
+ * option will automatically exclude compilation of asset.c and remove
+ * asset.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBASSET_DISABLE 0
+
+/**
+ * @def _ASSET_BLOCK
+ * 
+ * @brief Size of each of the two buffers of an asset stream in bytes
+ * 
+ * Every stream holds two buffers of this size, one used by the
+ * application and one being filled in the background. Set outside of the
+ * settings section since asset_stream_t in asset.h depends on it.
+ **************************************************************************/
+#define _ASSET_BLOCK 32
+
+#ifdef __LIBASSET_SETTINGS
+
+/**
+ * @def _ASSET_DEV
+ * 
+ * @brief Device address of the EEPROM chip holding the asset image
+ * 
+ * The default uses a second chip since the first one is shared by the
+ * data logger, the configuration and the record store.
+ * 
+ * @def _ASSET_ADDRESS
+ * 
+ * @brief Address of the start of the asset image in the chip
+ * 
+ * @def _ASSET_INDEX
+ * 
+ * @brief Maximum number of assets in the image
+ * 
+ * The index table is kept in RAM and takes 4 bytes per asset.
+ **************************************************************************/
+#define _ASSET_DEV 1
+#define _ASSET_ADDRESS 0x0000
+#define _ASSET_INDEX 32
+
+#endif
+
+/** 
+ * @def __LIBMEASURE_DISABLE
+ * 
+ * @brief Set to 1 to disable the signal measurement library
+ * 
+ * Enables or disables the signal measurement library. Disabling using
+ * this option will automatically exclude compilation of measure.c and
+ * remove measure.h from inclusion in the main header PIC24_toolbox.h
+ **************************************************************************/
+#define __LIBMEASURE_DISABLE 0
\ No newline at end of file